@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""Benchmark runner for sat_opt.
+
+  bench.py run [options] [files or directories...]   run the suites and write a CSV or JSON report
+  bench.py compare OLD NEW                           compare two reports
+
+By default every tests/uf* suite, tests/card/ and Bejing/ are run. Models are checked against the CNF (sat_opt also
+checks them itself); UNSAT answers are checked with a DRAT checker such as drat-trim when one is given or found on
+PATH. An instance whose header comments include "c expect: SATISFIABLE" or "c expect: UNSATISFIABLE" also fails its
+check when the answer differs; that covers constraints that proofs do not.
+"""
+
+import argparse
+import concurrent.futures
+import csv
+import glob
+import json
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+FIELDS = ['instance', 'status', 'check', 'time', 'conflicts', 'decisions', 'propagations', 'rss_kb']
+
+
+def instances(paths):
+    if not paths:
+        paths = sorted(glob.glob('tests/uf*')) + ['tests/card', 'Bejing']
+    for path in paths:
+        if os.path.isdir(path):
+            yield from sorted(glob.glob(os.path.join(path, '*.cnf')))
+        elif os.path.exists(path):
+            yield path
+        else:
+            sys.exit(f'{path}: no such file or directory')
+
+
+def read_cnf(path):
+    """Clauses, cardinality constraints as (literals, at-most bound) with ">= K" turned around, and XOR constraints
+    as (variables, parity) with the signs of their literals folded into the parity."""
+    clauses, cards, xors, clause = [], [], [], []
+    with open(path) as f:
+        for line in f:
+            tokens = line.split()
+            if not tokens or tokens[0] in ('c', 'p'):
+                continue
+            if tokens[0] == '%':
+                break
+            if tokens[0].startswith('x') and not clause:  # "x1 -2 3 0" or "x 1 -2 3 0": the literals add up to true
+                lits = [int(token) for token in [tokens[0][1:]] + tokens[1:] if token]
+                lits = lits[:lits.index(0)] if 0 in lits else lits
+                vars = set()
+                for lit in lits:
+                    vars ^= {abs(lit)}  # a repeated variable cancels out
+                xors.append((vars, (1 + sum(lit < 0 for lit in lits)) % 2))
+                continue
+            for i, token in enumerate(tokens):
+                if token in ('<=', '>='):
+                    lits, bound = set(clause), int(tokens[i + 1])
+                    if token == '>=':
+                        lits, bound = {-lit for lit in lits}, len(lits) - bound
+                    cards.append((lits, bound))
+                    clause = []
+                    break
+                lit = int(token)
+                if lit == 0:
+                    clauses.append(clause)
+                    clause = []
+                else:
+                    clause.append(lit)
+    if clause:
+        clauses.append(clause)
+    return clauses, cards, xors
+
+
+def expected_status(path):
+    """The answer named by a "c expect:" line among the comments before the header, or None."""
+    with open(path) as f:
+        for line in f:
+            tokens = line.split()
+            if tokens[:1] != ['c']:
+                return None
+            if tokens[1:2] == ['expect:'] and len(tokens) > 2:
+                return tokens[2]
+    return None
+
+
+def check_model(path, model):
+    true = set(model)
+    clauses, cards, xors = read_cnf(path)
+    return (all(any(lit in true for lit in clause) for clause in clauses) and
+            all(len(lits & true) <= bound for lits, bound in cards) and
+            all(len(vars & true) % 2 == parity for vars, parity in xors))
+
+
+def run_one(path, args):
+    row = dict.fromkeys(FIELDS, '')
+    row['instance'] = path
+    with tempfile.TemporaryDirectory() as tmp:
+        out_path = os.path.join(tmp, 'out')
+        proof_path = os.path.join(tmp, 'proof')
+        cmd = [args.solver, '-v']
+        if args.checker:
+            cmd += ['-B', '-C', proof_path]
+        cmd.append(path)
+        start = time.monotonic()
+        with open(out_path, 'w') as out:
+            proc = subprocess.Popen(cmd, stdout=out, stderr=subprocess.DEVNULL)
+            try:
+                proc.wait(timeout=args.timeout)
+            except subprocess.TimeoutExpired:
+                proc.kill()
+                proc.wait()
+        row['time'] = round(time.monotonic() - start, 3)
+        model = []
+        with open(out_path) as out:
+            for line in out:
+                if line.startswith('s '):
+                    row['status'] = line.split()[1]
+                elif line.startswith('v '):
+                    model += [int(token) for token in line.split()[1:]]
+                elif line.startswith('c conflicts:'):
+                    for item in line[2:].split(','):
+                        key, value = item.split(':')
+                        row[key.strip()] = int(value)
+                elif line.startswith('c peak memory:'):  # the solver's own count; rusage would include our fork
+                    row['rss_kb'] = int(line.split()[3])
+        if proc.returncode < 0:
+            row['status'] = 'TIMEOUT'
+        elif not row['status']:
+            row['status'] = 'ERROR'
+        expected = expected_status(path)
+        if expected and solved(row) and row['status'] != expected:
+            row['check'] = 'FAILED'
+        elif row['status'] == 'SATISFIABLE':
+            row['check'] = 'ok' if check_model(path, model) else 'FAILED'
+        elif row['status'] == 'UNSATISFIABLE' and args.checker:
+            try:
+                result = subprocess.run([args.checker, path, proof_path], stdout=subprocess.PIPE,
+                                        stderr=subprocess.DEVNULL, timeout=10 * args.timeout, text=True)
+                row['check'] = 'ok' if 's VERIFIED' in result.stdout else 'FAILED'
+            except subprocess.TimeoutExpired:
+                row['check'] = 'timeout'
+        elif row['status'] == 'UNSATISFIABLE':
+            row['check'] = 'unchecked'
+    return row
+
+
+def write_report(rows, path):
+    if path.endswith('.json'):
+        with open(path, 'w') as f:
+            json.dump(rows, f, indent=1)
+        return
+    with open(path, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+
+def read_report(path):
+    if path.endswith('.json'):
+        with open(path) as f:
+            return json.load(f)
+    with open(path, newline='') as f:
+        return list(csv.DictReader(f))
+
+
+def solved(row):
+    return row['status'] in ('SATISFIABLE', 'UNSATISFIABLE')
+
+
+def par2(row, timeout):
+    return float(row['time']) if solved(row) else 2 * timeout
+
+
+def cmd_run(args):
+    if args.checker is None:
+        args.checker = shutil.which('drat-trim')
+    files = list(instances(args.paths))
+    rows = []
+    with concurrent.futures.ThreadPoolExecutor(args.jobs) as pool:
+        for row in pool.map(lambda path: run_one(path, args), files):
+            rows.append(row)
+            if row['check'] == 'FAILED' or row['status'] == 'ERROR':
+                print(f"{row['instance']}: {row['status']} check {row['check']}", file=sys.stderr)
+    write_report(rows, args.output)
+    failed = sum(row['check'] == 'FAILED' for row in rows)
+    print(f'{sum(map(solved, rows))}/{len(rows)} solved, {failed} failed checks, '
+          f'PAR-2 {sum(par2(row, args.timeout) for row in rows):.1f} s -> {args.output}')
+    return 1 if failed else 0
+
+
+def cmd_compare(args):
+    old = {row['instance']: row for row in read_report(args.old)}
+    new = {row['instance']: row for row in read_report(args.new)}
+    suites = {}
+    for name in old.keys() & new.keys():
+        suites.setdefault(os.path.dirname(name), []).append(name)
+    print(f"{'suite':24} {'solved':>14} {'PAR-2 (s)':>22} {'conflicts':>26} {'speedup':>8}")
+    for suite, names in sorted(suites.items()):
+        cols = []
+        for runs in (old, new):
+            rows = [runs[name] for name in names]
+            cols.append((sum(map(solved, rows)), sum(par2(row, args.timeout) for row in rows),
+                         sum(int(row['conflicts'] or 0) for row in rows)))
+        both = [name for name in names if solved(old[name]) and solved(new[name])]
+        logs = [math.log(max(float(old[n]['time']), 1e-3) / max(float(new[n]['time']), 1e-3)) for n in both]
+        speedup = math.exp(sum(logs) / len(logs)) if logs else float('nan')
+        (s0, p0, c0), (s1, p1, c1) = cols
+        print(f'{suite:24} {s0:6} -> {s1:4} {p0:9.1f} -> {p1:9.1f} {c0:11} -> {c1:11} {speedup:7.2f}x')
+    for name in sorted(old.keys() & new.keys()):
+        a, b = old[name], new[name]
+        if a['status'] != b['status']:
+            print(f"{name}: {a['status']} -> {b['status']}")
+        elif solved(a) and max(float(a['time']), float(b['time'])) >= args.min_time:
+            ratio = max(float(b['time']), 1e-3) / max(float(a['time']), 1e-3)
+            if ratio >= 2 or ratio <= 0.5:
+                print(f"{name}: {a['time']} s -> {b['time']} s")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+    run = sub.add_parser('run')
+    run.add_argument('paths', nargs='*')
+    run.add_argument('-o', '--output', default='bench.csv', help='report file (.csv or .json)')
+    run.add_argument('-j', '--jobs', type=int, default=os.cpu_count())
+    run.add_argument('-t', '--timeout', type=float, default=60)
+    run.add_argument('--solver', default='./sat_opt')
+    run.add_argument('--checker', help='DRAT checker run as CHECKER CNF PROOF (default: drat-trim if found)')
+    compare = sub.add_parser('compare')
+    compare.add_argument('old')
+    compare.add_argument('new')
+    compare.add_argument('-t', '--timeout', type=float, default=60, help='timeout the runs used, for PAR-2')
+    compare.add_argument('--min-time', type=float, default=0.1, help='ignore instances faster than this')
+    args = parser.parse_args()
+    return cmd_run(args) if args.command == 'run' else cmd_compare(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,100 @@
+#include "solver.h"
+#include <algorithm>
+
+using namespace std;
+
+// Cardinality constraints are kept apart from the clauses and visited, through `card_list`, whenever one of their
+// literals becomes true. Each one counts its true literals as they are assigned and unassigned, so a visit costs
+// nothing until the count reaches the bound; only then are the literals scanned. When `bound` of them are true, the
+// others are implied false, and the true ones are saved as the reason. `analyze` reads that reason as the clause
+// (-lit | -t1 | ... | -tk) only when it needs it, so a large at-most-one costs neither the quadratic pairwise clauses
+// nor a reason clause per implication.
+
+bool solver::add_at_most(const int * lits, uint num_lit, uint bound) {
+    if (! ok)
+        return false;
+    backjump(0);
+    if (extended)
+        retract_model();
+    vector<int> new_lits(lits, lits + num_lit);
+    for (int lit : new_lits) {
+        while ((uint) abs(lit) > N)
+            new_var();
+    }
+    // The literals are a set, so repeats go before the values at level 0 are counted: otherwise a repeated true
+    // literal would take from the bound twice.
+    sort(new_lits.begin(), new_lits.end(), [](int a, int b) { return abs(a) != abs(b) ? abs(a) < abs(b) : a < b; });
+    new_lits.erase(unique(new_lits.begin(), new_lits.end()), new_lits.end());
+    uint size = 0;
+    for (uint i = 0; i < new_lits.size(); ++i) {
+        if (size > 0 && new_lits[size - 1] == -new_lits[i]) { // exactly one of the two is true
+            if (bound == 0)
+                return ok = false;
+            --bound;
+            --size;
+            continue;
+        }
+        new_lits[size++] = new_lits[i];
+    }
+    new_lits.resize(size);
+    size = 0;
+    for (int lit : new_lits) {
+        if (ev(abs(lit)) == -lit)
+            continue;
+        if (ev(abs(lit)) == lit) { // true at level 0; it takes one from the bound
+            if (bound == 0)
+                return ok = false;
+            --bound;
+            continue;
+        }
+        new_lits[size++] = lit;
+    }
+    new_lits.resize(size);
+    if (new_lits.size() <= bound)
+        return true;
+    if (bound == 0) {
+        for (int lit : new_lits)
+            push(-lit, NO_CLAUSE, 0);
+        if (find_conflict())
+            return ok = false;
+        return true;
+    }
+    uint index = cards.size();
+    for (int lit : new_lits) {
+        frozen[abs(lit)] = true;
+        card_list(lit).push_back(index);
+    }
+    cards.push_back({ bound, 0, move(new_lits), {} });
+    return true;
+}
+
+// Called when a literal of constraint `index` has become true. Returns false if too many are true, with the
+// negations of the true ones in `constraint_conflict`.
+bool solver::propagate_card(uint index) {
+    auto & c = cards[index];
+    if (c.num_true < c.bound)
+        return true;
+    if (c.num_true > c.bound) {
+        constraint_conflict.clear();
+        for (int lit : c.lits) {
+            if (ev(abs(lit)) == lit)
+                constraint_conflict.push_back(-lit);
+        }
+        return false;
+    }
+    // The literals it implied before are still assigned only if the same ones are true, so the reason stays valid
+    // for them.
+    c.reason.clear();
+    uint lv = 0; // the implied literals can be below the current level after chronological backtracking
+    for (int lit : c.lits) {
+        if (ev(abs(lit)) == lit) {
+            c.reason.push_back(-lit);
+            lv = max(lv, vars[abs(lit)].level);
+        }
+    }
+    for (int lit : c.lits) {
+        if (! defined(abs(lit)))
+            push(-lit, CARD_REASON | index, lv);
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#define EXCHANGE_CAPACITY (1 << 14) // number of clauses kept in the ring
+#define EXCHANGE_MAX_LITS 16 // longer clauses are never shared
+
+// A bounded lock-free ring through which portfolio threads broadcast learnt clauses. A writer claims a slot with
+// fetch_add and publishes it under a sequence number (a seqlock); every reader keeps its own position. Readers that
+// fall more than EXCHANGE_CAPACITY clauses behind silently lose the overwritten ones.
+struct clause_exchange {
+    struct slot {
+        std::atomic<uint64_t> seq { 0 }; // 2 * pos + 1 while clause pos is written, 2 * pos + 2 once published
+        std::atomic<unsigned> owner;
+        std::atomic<unsigned> num_lit;
+        std::atomic<unsigned> lbd;
+        std::atomic<int> lits[EXCHANGE_MAX_LITS];
+    };
+    std::atomic<uint64_t> head { 0 };
+    std::unique_ptr<slot[]> slots { new slot[EXCHANGE_CAPACITY] };
+
+    void push(unsigned owner, const int * lits, unsigned num_lit, unsigned lbd) {
+        if (num_lit > EXCHANGE_MAX_LITS)
+            return;
+        uint64_t pos = head.fetch_add(1, std::memory_order_relaxed);
+        slot & s = slots[pos % EXCHANGE_CAPACITY];
+        s.seq.store(2 * pos + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.owner.store(owner, std::memory_order_relaxed);
+        s.num_lit.store(num_lit, std::memory_order_relaxed);
+        s.lbd.store(lbd, std::memory_order_relaxed);
+        for (unsigned i = 0; i < num_lit; ++i)
+            s.lits[i].store(lits[i], std::memory_order_relaxed);
+        s.seq.store(2 * pos + 2, std::memory_order_release);
+    }
+
+    // Fetch the next clause published by someone other than `reader` after position `pos`.
+    bool pull(unsigned reader, uint64_t & pos, std::vector<int> & lits, unsigned & lbd) {
+        uint64_t end = head.load(std::memory_order_acquire);
+        if (end - pos > EXCHANGE_CAPACITY)
+            pos = end - EXCHANGE_CAPACITY;
+        for (; pos < end; ++pos) {
+            slot & s = slots[pos % EXCHANGE_CAPACITY];
+            uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq < 2 * pos + 2)
+                return false; // still being written; try again later
+            if (seq > 2 * pos + 2 || s.owner.load(std::memory_order_relaxed) == reader)
+                continue; // overwritten or our own
+            unsigned num_lit = s.num_lit.load(std::memory_order_relaxed);
+            lbd = s.lbd.load(std::memory_order_relaxed);
+            lits.resize(num_lit);
+            for (unsigned i = 0; i < num_lit; ++i)
+                lits[i] = s.lits[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq)
+                continue; // overwritten while we were reading
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+};
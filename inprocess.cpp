@@ -0,0 +1,291 @@
+#include "solver.h"
+#include <algorithm>
+
+using namespace std;
+
+#define INPROCESS_EFFORT 0.1 // propagations allowed for probing and vivification, relative to those of the search
+#define PROBE_SHARE 0.5 // the part of the effort given to probing; vivification gets the rest
+
+uint lit_index(int lit) {
+    return 2 * abs(lit) + (lit < 0);
+}
+int index_lit(uint i) {
+    return (i & 1) != 0 ? -(int) (i >> 1) : (int) (i >> 1);
+}
+
+// Drop the deleted clauses from `db` and their watchers, and compact the arena.
+void solver::purge_deleted() {
+    for (auto & tier : db) {
+        tier.erase(remove_if(tier.begin(), tier.end(), [&](auto r) {
+            return (deref(r)->flags & CLAUSE_DELETED) != 0;
+        }), tier.end());
+    }
+    sweep_watches();
+    collect_garbage();
+}
+
+// Pause the search at level 0 for probing, vivification and equivalent literal substitution. Probing and
+// vivification propagate with assignments of their own, so the saved phases are restored afterwards. Returns false
+// on unsatisfiability.
+bool solver::inprocess() {
+    backjump(0);
+    inprocess_interval += INPROCESS_INTERVAL;
+    next_inprocess = num_conflicts + inprocess_interval;
+    STAT(++stats.inprocessings);
+    uint64_t effort = (num_propagations - inprocess_propagations) * INPROCESS_EFFORT;
+    vector<uchar> saved(model);
+    bool res = probe(effort * PROBE_SHARE) && vivify(effort * (1 - PROBE_SHARE)) && substitute();
+    for (uint v = 1; v <= N; ++v) {
+        if (! defined(v))
+            model[v] = saved[v] & MODEL_PHASE;
+    }
+    inprocess_propagations = num_propagations;
+    return res;
+}
+
+// Failed literal probing. Propagate each root of the binary implication graph (a literal that is implied by no
+// binary clause but implies something); if that leads to a conflict, the negation is a unit. Continues where the
+// last call stopped.
+bool solver::probe(uint64_t budget) {
+    TIME_PHASE(PHASE_PROBE);
+    uint64_t limit = num_propagations + budget;
+    for (uint k = 0; k < N && num_propagations < limit; ++k) {
+        probe_next = probe_next % N + 1;
+        uint v = probe_next;
+        if (defined(v) || eliminated[v])
+            continue;
+        for (int lit : { (int) v, -(int) v }) {
+            if (! bin_list(lit).empty() || bin_list(-lit).empty() || defined(v))
+                continue;
+            new_level(lit);
+            bool failed = find_conflict().has_value();
+            backjump(0);
+            if (! failed)
+                continue;
+            STAT(++stats.failed_literals);
+            if (proof)
+                proof->add(&lit, 1, true);
+            push(-lit, NO_CLAUSE, 0);
+            if (find_conflict())
+                return ok = false;
+        }
+    }
+    return true;
+}
+
+// Vivification of the learnt clauses worth keeping. Assign the literals of a clause false one by one; when a
+// conflict comes, or a later literal becomes true, the literals after that point are redundant, and literals that
+// become false can go as well. Each clause is tried once.
+bool solver::vivify(uint64_t budget) {
+    TIME_PHASE(PHASE_VIVIFY);
+    simplify();
+    uint64_t limit = num_propagations + budget;
+    vector<clause_ref> candidates;
+    for (uint t = TIER_CORE; t <= TIER_2; ++t) {
+        for (auto r : db[t]) {
+            if ((deref(r)->flags & (CLAUSE_LEARNT | CLAUSE_VIVIFIED)) == CLAUSE_LEARNT)
+                candidates.push_back(r);
+        }
+    }
+    sort(candidates.begin(), candidates.end(), [&](auto x, auto y) { return deref(x)->score < deref(y)->score; });
+    vector<clause_ref> replaced;
+    vector<int> lits, kept;
+    for (auto r : candidates) {
+        if (num_propagations >= limit || ! ok)
+            break;
+        auto c = deref(r);
+        c->flags |= CLAUSE_VIVIFIED;
+        if ((c->flags & CLAUSE_DELETED) != 0 || locked(r))
+            continue;
+        lits.assign(c->lits, c->lits + c->num_lit);
+        kept.clear();
+        for (int lit : lits) {
+            if (ev(abs(lit)) == lit) {
+                kept.push_back(lit);
+                break;
+            }
+            if (ev(abs(lit)) == -lit)
+                continue;
+            kept.push_back(lit);
+            new_level(-lit);
+            if (find_conflict())
+                break;
+        }
+        backjump(0);
+        if (kept.size() == lits.size())
+            continue;
+        STAT(++stats.vivified);
+        STAT(stats.vivified_literals += lits.size() - kept.size());
+        if (proof)
+            proof->add(kept.data(), kept.size());
+        uint score = min<uint>(c->score, kept.size());
+        float activity = c->activity;
+        int used = c->flags & CLAUSE_USED;
+        free_clause(r); // but it is still watched, and it remains a valid clause until the sweep
+        replaced.push_back(r);
+        auto & tier = db[lbd_tier(score)];
+        uint size = tier.size();
+        attach(kept.data(), kept.size(), CLAUSE_LEARNT, score); // may move the arena
+        if (tier.size() > size) { // keep the standing of the old clause, or the next reduce would drop the new one
+            deref(tier.back())->activity = activity;
+            deref(tier.back())->flags |= used;
+        }
+    }
+    if (proof && cert_deletions) { // after the propagation of any new units, since a checker may need their reasons
+        for (auto r : replaced) {
+            auto c = deref(r);
+            if (! locked(r))
+                proof->remove(c->lits, c->num_lit);
+        }
+    }
+    purge_deleted();
+    return ok;
+}
+
+// Equivalent literal substitution. The strongly connected components of the binary implication graph (Tarjan's
+// algorithm, without recursion) are equivalence classes; every literal is replaced by the representative of its
+// class in all clauses, and the replaced variables are eliminated, with their equivalences on `elim_stack`.
+bool solver::substitute() {
+    TIME_PHASE(PHASE_SUBSTITUTE);
+    simplify();
+    uint size = 2 * N + 2;
+    vector<uint> num(size), low(size);
+    vector<bool> on_stack(size), in_scc(size);
+    vector<uint> component;
+    vector<pair<uint, uint>> dfs; // node and position in its list of successors
+    vector<int> repr(N + 1); // literal that replaces var, or 0
+    uint counter = 0, num_substituted = 0;
+    for (uint root = 2; root < size; ++root) {
+        if (num[root] != 0 || defined(root >> 1) || eliminated[root >> 1])
+            continue;
+        num[root] = low[root] = ++counter;
+        component.push_back(root);
+        on_stack[root] = true;
+        dfs.emplace_back(root, 0);
+        while (! dfs.empty()) {
+            auto & [node, pos] = dfs.back();
+            auto & succ = bin_list(-index_lit(node)); // literals implied by the node's
+            if (pos < succ.size()) {
+                uint next = lit_index(succ[pos++]);
+                if (defined(next >> 1))
+                    continue;
+                if (num[next] == 0) {
+                    num[next] = low[next] = ++counter;
+                    component.push_back(next);
+                    on_stack[next] = true;
+                    dfs.emplace_back(next, 0);
+                } else if (on_stack[next]) {
+                    low[node] = min(low[node], num[next]);
+                }
+                continue;
+            }
+            uint done = node;
+            dfs.pop_back();
+            if (! dfs.empty())
+                low[dfs.back().first] = min(low[dfs.back().first], low[done]);
+            if (low[done] != num[done])
+                continue;
+            auto begin = component.end();
+            do { // pop the component off the top of the stack, down to its root
+                in_scc[*--begin] = true;
+            } while (*begin != done);
+            int rep = 0;
+            for (auto p = begin; p != component.end(); ++p) {
+                int lit = index_lit(*p);
+                if (in_scc[lit_index(-lit)]) { // lit and its negation are equivalent
+                    if (proof)
+                        proof->add(&lit, 1, true);
+                    return ok = false;
+                }
+                if (rep == 0 || (frozen[abs(lit)] && ! frozen[abs(rep)])
+                    || (frozen[abs(lit)] == frozen[abs(rep)] && abs(lit) < abs(rep)))
+                    rep = lit;
+            }
+            for (auto p = begin; p != component.end(); ++p) {
+                on_stack[*p] = in_scc[*p] = false;
+                int lit = index_lit(*p);
+                if (lit != rep && ! frozen[abs(lit)] && repr[abs(lit)] == 0) {
+                    repr[abs(lit)] = lit > 0 ? rep : -rep;
+                    ++num_substituted;
+                }
+            }
+            component.erase(begin, component.end());
+        }
+    }
+    if (num_substituted == 0)
+        return true;
+    STAT(stats.substituted += num_substituted);
+    auto map = [&](int lit) { return repr[abs(lit)] == 0 ? lit : lit > 0 ? repr[abs(lit)] : -repr[abs(lit)]; };
+    for (uint v = 1; v <= N; ++v) {
+        if (repr[v] == 0)
+            continue;
+        for (int lit : { (int) v, -(int) v }) { // lit or the negation of its representative
+            int other = lit > 0 ? -repr[v] : repr[v];
+            elim_stack.insert(elim_stack.end(), { lit, other, 2 });
+        }
+        eliminated[v] = true;
+    }
+
+    // rewrite the clauses, logging each new one before the old one is deleted
+    vector<int> lits;
+    vector<pair<vector<int>, pair<int, uint>>> pending; // clauses to attach, with flags and score
+    auto rewrite = [&](const int * begin, const int * end, int flags, uint score) { // false if unchanged
+        if (none_of(begin, end, [&](int lit) { return repr[abs(lit)] != 0; }))
+            return false;
+        lits.clear();
+        bool tautology = false;
+        for (auto p = begin; p != end; ++p) {
+            int lit = map(*p);
+            if (find(lits.begin(), lits.end(), -lit) != lits.end())
+                tautology = true;
+            if (find(lits.begin(), lits.end(), lit) == lits.end())
+                lits.push_back(lit);
+        }
+        if (! tautology) {
+            if (proof)
+                proof->add(lits.data(), lits.size());
+            pending.push_back({ lits, { flags, score } });
+        }
+        STAT(++stats.substituted_clauses);
+        return true;
+    };
+    vector<pair<int, int>> binaries;
+    for (uint v = 1; v <= N; ++v) {
+        for (int a : { (int) v, -(int) v }) {
+            for (int b : bin_list(a)) {
+                if (lit_index(a) < lit_index(b))
+                    binaries.emplace_back(a, b);
+            }
+            bin_list(a).clear();
+        }
+    }
+    vector<int> deleted;
+    for (auto [a, b] : binaries) {
+        int pair[2] = { a, b };
+        if (! rewrite(pair, pair + 2, 0, 0))
+            add_binary(a, b);
+        else
+            deleted.insert(deleted.end(), { a, b, 0 });
+    }
+    for (auto & tier : db) {
+        for (auto r : tier) {
+            auto c = deref(r);
+            if (rewrite(c->lits, c->lits + c->num_lit, c->flags & CLAUSE_LEARNT, c->score)) {
+                if (proof && cert_deletions)
+                    proof->remove(c->lits, c->num_lit);
+                free_clause(r);
+            }
+        }
+    }
+    if (proof && cert_deletions) {
+        for (uint i = 0; i < deleted.size(); i += 3)
+            proof->remove(&deleted[i], 2);
+    }
+    purge_deleted();
+    rebuild_queue();
+    for (uint i = 0; i < pending.size() && ok; ++i) {
+        auto & [clause_lits, info] = pending[i];
+        attach(clause_lits.data(), clause_lits.size(), info.first, info.second);
+    }
+    return ok;
+}
@@ -1,8 +1,17 @@
+#include "sink.h"
 #include <cstdio>
+#include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <utility>
+extern "C" {
+#include <unistd.h>
+}
 
 using namespace std;
 
@@ -18,12 +27,58 @@ using namespace std;
 
 #define PREC(op) (10 - (op)) // ugly but sufficient
 
+// Subformulas are hash-consed into an and-inverter graph with equivalence gates, as in AIGER: a subformula is a
+// literal, a node index negated for negation, so that negation costs nothing and p | q, p -> q and ~p & ~q all share
+// the node of an and gate.
 struct subf {
-    int op;
-    int arg[2];
+    int op; // LVAR, LAND or LBIMP
+    int arg[2]; // literals; arg[0] < arg[1] for a gate
 };
 vector<subf> subfs; // recursive descent parser automatically enumerates all subformulas
 
+struct gate_hash {
+    size_t operator()(const subf & g) const {
+        return hash<uint64_t>()((uint64_t) (unsigned) g.arg[0] << 32 ^ (unsigned) g.arg[1]) ^ g.op;
+    }
+};
+struct gate_eq {
+    bool operator()(const subf & x, const subf & y) const {
+        return x.op == y.op && x.arg[0] == y.arg[0] && x.arg[1] == y.arg[1];
+    }
+};
+unordered_map<subf, int, gate_hash, gate_eq> gates; // structural hashing
+
+int make_gate(int op, int p, int q) {
+    if (p > q)
+        swap(p, q);
+    auto it = gates.find({ op, p, q });
+    if (it != gates.end())
+        return it->second;
+    subfs.push_back({ op, p, q });
+    gates.emplace(subfs.back(), subfs.size() - 1);
+    return subfs.size() - 1;
+}
+
+int make_and(int p, int q) {
+    if (p == q)
+        return p;
+    return make_gate(LAND, p, q);
+}
+
+int make_bimp(int p, int q) { // negations move out: ~p <-> q = ~(p <-> q)
+    int sign = (p < 0) != (q < 0) ? -1 : 1;
+    return sign * make_gate(LBIMP, abs(p), abs(q));
+}
+
+int make(int op, int p, int q) {
+    switch (op) {
+    case LAND: return make_and(p, q);
+    case LOR: return -make_and(-p, -q);
+    case LIMP: return -make_and(p, -q);
+    default: return make_bimp(p, q);
+    }
+}
+
 unordered_map<string, int> map;
 
 [[noreturn]] void error(const char *str) {
@@ -86,9 +141,7 @@ int parse();
 int parse_primary() {
     int k = get_token();
     if (k == LNEG) {
-        k = parse_primary();
-        subfs.push_back({ LNEG, k });
-        return subfs.size() - 1;
+        return -parse_primary();
     } else if (k == LVAR) {
         auto it = map.find(name);
         if (it != map.end()) {
@@ -122,8 +175,7 @@ int parse_1(int lhs, int prec) {
                 break;
             rhs = parse_1(rhs, PREC(op));
         }
-        subfs.push_back({ op, lhs, rhs });
-        lhs = subfs.size() - 1;
+        lhs = make(op, lhs, rhs);
     }
     return lhs;
 }
@@ -133,65 +185,101 @@ int parse() {
     return parse_1(k, 0);
 }
 
-// void print() {
-//     for (int i = 1; i < subfs.size(); ++i) {
-//         auto [op, arg] = subfs[i];
-//         if (op == LVAR)
-//             continue;
-//         int p = arg[0], q = arg[1];
-//         switch (op) {
-//         case LNEG: fprintf(stderr, "%d <-> ~%d\n", i, p); break;
-//         case LAND: fprintf(stderr, "%d <-> %d & %d\n", i, p, q); break;
-//         case LOR: fprintf(stderr, "%d <-> %d | %d\n", i, p, q); break;
-//         case LIMP: fprintf(stderr, "%d <-> %d -> %d\n", i, p, q); break;
-//         case LBIMP: fprintf(stderr, "%d <-> (%d <-> %d)\n", i, p, q); break;
-//         }
-//     }
-// }
-
-int main() {
+enum {
+    POS = 1, // the subformula occurs positively: only gate -> definition is needed
+    NEG = 2, // negatively: only definition -> gate
+};
+
+// Read a formula from stdin and write its CNF to stdout, as DIMACS text or, with -b, in the binary format of sat.
+// With -s the clauses go straight into a solver in this process instead, and the values of the named variables of a
+// model are printed.
+//
+// Memory is not constant: the graph of distinct subformulas is kept until the clauses are made. Both hash-consing
+// and the polarities need it, since an equal subformula may come back and the polarity of a gate is known only once
+// every gate that uses it has been read, which may be at the end of the input. What streams is the part that used
+// to dominate: about two clauses a gate, which are never collected. The hash table goes before they are made.
+int main(int argc, char * argv[]) {
+    bool opt_binary = false, opt_solve = false;
+    int c;
+    while ((c = getopt(argc, argv, "bs")) != -1) {
+        switch (c) {
+        case 'b':
+            opt_binary = true;
+            break;
+        case 's':
+            opt_solve = true;
+            break;
+        default:
+            error("usage: logic [-b | -s] < FORMULA\n");
+        }
+    }
     subfs.push_back({}); // avoid 0
     int k = parse();
+    decltype(gates)().swap(gates); // only needed for hashing
 
-    // Tseitin transformation
-    vector<vector<int>> db;
-    for (int i = 1; i < subfs.size(); ++i) {
+    // Polarities, from the root down; the arguments of a gate come before it
+    vector<unsigned char> pol(subfs.size());
+    pol[abs(k)] = k > 0 ? POS : NEG;
+    for (int i = subfs.size() - 1; i > 0; --i) {
+        auto [op, arg] = subfs[i];
+        if (op == LAND) {
+            for (int p : arg)
+                pol[abs(p)] |= p > 0 ? pol[i] : (pol[i] & POS) << 1 | (pol[i] & NEG) >> 1;
+        } else if (op == LBIMP && pol[i] != 0) {
+            pol[arg[0]] = pol[arg[1]] = POS | NEG;
+        }
+    }
+
+    // Tseitin transformation with the polarities of Plaisted and Greenbaum
+    solver S;
+    unique_ptr<clause_sink> sink;
+    if (opt_solve)
+        sink = make_unique<solver_sink>(S);
+    else
+        sink = make_unique<cnf_writer>(stdout, opt_binary);
+    auto & W = *sink;
+    for (int i = 1; i < (int) subfs.size(); ++i) {
         auto [op, arg] = subfs[i];
-        if (op == LVAR)
-            continue;
         int r = i, p = arg[0], q = arg[1];
         switch (op) {
-        case LNEG: // r<->~p = r->~p & ~p->r = ~r|~p & p|r
-            db.push_back({ r, p });
-            db.push_back({ -r, -p });
-            break;
-        case LIMP: // r<->p->q = r->~p|q
-            p = -p;
-            [[fallthrough]];
-        case LOR: // r<->p|q = ~r<->~p&~q
-            r = -r;
-            p = -p;
-            q = -q;
-            [[fallthrough]];
-        case LAND: // r<->p&q = r->p&q & p&q->r = ~r|p&q & ~p|~q|r = ~r|p & ~r|q & ~p|~q|r
-            db.push_back({ -r, p });
-            db.push_back({ -r, q });
-            db.push_back({ r, -p, -q });
+        case LAND: // r<->p&q = r->p&q & p&q->r = ~r|p & ~r|q & ~p|~q|r
+            if (pol[i] & POS) {
+                W.add({ -r, p });
+                W.add({ -r, q });
+            }
+            if (pol[i] & NEG)
+                W.add({ r, -p, -q });
             break;
         case LBIMP: // r<->(p<->q) = r->(p<->q) & (p<->q)->r = ~r|((p|~q)&(~p|q)) & ~((p&q)|(~p&~q))|r
-            db.push_back({ -r, p, -q });
-            db.push_back({ -r, -p, q });
-            db.push_back({ r, -p, -q });
-            db.push_back({ r, p, q });
+            if (pol[i] & POS) {
+                W.add({ -r, p, -q });
+                W.add({ -r, -p, q });
+            }
+            if (pol[i] & NEG) {
+                W.add({ r, -p, -q });
+                W.add({ r, p, q });
+            }
             break;
         }
     }
-    db.push_back({ k });
+    W.add({ k });
+    W.finish(subfs.size() - 1);
+    if (! opt_solve)
+        return 0;
 
-    printf("p cnf %lu %lu\n", subfs.size() - 1, db.size());
-    for (auto & clause : db) {
-        for (auto lit : clause)
-            printf("%d ", lit);
-        printf("0\n");
+    result res = S.solve();
+    if (res != SATISFIABLE) {
+        puts(res == UNSATISFIABLE ? "s UNSATISFIABLE" : "s UNKNOWN");
+        return res;
     }
-}
\ No newline at end of file
+    puts("s SATISFIABLE");
+    vector<pair<int, const string *>> names;
+    for (auto & [name, v] : map)
+        names.push_back({ v, &name });
+    sort(names.begin(), names.end());
+    printf("v");
+    for (auto [v, name] : names)
+        printf(" %s%s", S.value(v) > 0 ? "" : "~", name->c_str());
+    printf("\n");
+    return res;
+}
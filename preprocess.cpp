@@ -0,0 +1,313 @@
+#include "solver.h"
+#include <algorithm>
+
+using namespace std;
+
+#define PREPROCESS_BUDGET 200000000 // literals visited by subsumption and elimination altogether
+#define SUBSUME_MAX_SIZE 100 // longer clauses are not used to subsume others
+#define ELIM_MAX_RESOLVENT 20 // a variable is kept if one of its resolvents would be longer
+
+// SatELite-style preprocessing on a copy of the clauses with occurrence lists: backward subsumption and
+// self-subsuming resolution, then bounded variable elimination, which replaces the clauses of a variable by their
+// resolvents as long as that does not increase the number of clauses. Unit clauses are kept as clauses, so
+// subsumption also does their propagation. The removed clauses go to `elim_stack` for `extend_model`.
+struct preprocessor {
+    solver & S;
+    vector<vector<int>> clauses;
+    vector<uint64_t> sigs; // variables of a clause modulo 64; a subset test fails fast on them
+    vector<bool> removed;
+    vector<vector<uint>> occ; // by `index`; may contain removed clauses
+    vector<uint> queue; // clauses to subsume others with
+    vector<bool> queued;
+    vector<bool> mark; // by `index`
+    int64_t budget = PREPROCESS_BUDGET;
+
+    preprocessor(solver & S) : S(S), occ(2 * S.N + 2), mark(2 * S.N + 2) {
+    }
+    static uint index(int lit) {
+        return 2 * abs(lit) + (lit < 0);
+    }
+    static uint64_t signature(const vector<int> & lits) {
+        uint64_t sig = 0;
+        for (int lit : lits)
+            sig |= 1ull << (abs(lit) % 64);
+        return sig;
+    }
+
+    void add(vector<int> && lits) {
+        uint i = clauses.size();
+        for (int lit : lits)
+            occ[index(lit)].push_back(i);
+        sigs.push_back(signature(lits));
+        clauses.push_back(move(lits));
+        removed.push_back(false);
+        queued.push_back(true);
+        queue.push_back(i);
+    }
+    void remove(uint i) {
+        removed[i] = true;
+        if (S.proof && S.cert_deletions)
+            S.proof->remove(clauses[i].data(), clauses[i].size());
+    }
+    bool strengthen(uint i, int lit) { // false if the clause became empty
+        auto & lits = clauses[i];
+        lits.erase(find(lits.begin(), lits.end(), lit));
+        auto & list = occ[index(lit)];
+        list.erase(find(list.begin(), list.end(), i));
+        if (S.proof) {
+            S.proof->add(lits.data(), lits.size());
+            if (S.cert_deletions) {
+                lits.push_back(lit);
+                S.proof->remove(lits.data(), lits.size());
+                lits.pop_back();
+            }
+        }
+        sigs[i] = signature(lits);
+        if (! queued[i]) {
+            queued[i] = true;
+            queue.push_back(i);
+        }
+        STAT(++S.stats.strengthened);
+        return ! lits.empty();
+    }
+    // live clauses containing `lit`; the removed ones are dropped from the list
+    vector<uint> & occurrences(int lit) {
+        auto & list = occ[index(lit)];
+        list.erase(remove_if(list.begin(), list.end(), [&](uint i) { return removed[i]; }), list.end());
+        return list;
+    }
+
+    // Remove the clauses that clause c subsumes, and strengthen those it subsumes but for one negated literal. Such
+    // clauses contain c's literal of the rarest variable or its negation.
+    bool backward_subsume(uint c) {
+        auto & C = clauses[c];
+        if (C.size() > SUBSUME_MAX_SIZE)
+            return true;
+        int best = C[0];
+        for (int lit : C) {
+            if (occ[index(lit)].size() + occ[index(-lit)].size() < occ[index(best)].size() + occ[index(-best)].size())
+                best = lit;
+        }
+        vector<uint> candidates = occurrences(best);
+        auto & neg = occurrences(-best);
+        candidates.insert(candidates.end(), neg.begin(), neg.end());
+        for (int lit : C)
+            mark[index(lit)] = true;
+        bool ok = true;
+        for (uint d : candidates) {
+            auto & D = clauses[d];
+            if (d == c || removed[d] || D.size() < C.size() || (sigs[c] & ~sigs[d]) != 0)
+                continue;
+            budget -= D.size();
+            uint count = 0;
+            int flip = 0;
+            for (int lit : D) {
+                if (mark[index(lit)]) {
+                    ++count;
+                } else if (mark[index(-lit)]) {
+                    if (flip != 0)
+                        break;
+                    flip = lit;
+                    ++count;
+                }
+            }
+            if (count < C.size())
+                continue;
+            if (flip == 0) {
+                remove(d);
+                STAT(++S.stats.subsumed);
+            } else if (! strengthen(d, flip)) {
+                ok = false;
+                break;
+            }
+        }
+        for (int lit : C)
+            mark[index(lit)] = false;
+        return ok;
+    }
+
+    bool subsume() {
+        while (! queue.empty() && budget > 0) {
+            uint c = queue.back();
+            queue.pop_back();
+            queued[c] = false;
+            if (! removed[c] && ! backward_subsume(c))
+                return false;
+        }
+        return true;
+    }
+
+    // The resolvent of clauses p and n on var into `out`; false if it is a tautology.
+    bool resolve(uint p, uint n, uint var, vector<int> & out) {
+        out.clear();
+        budget -= clauses[p].size() + clauses[n].size();
+        for (int lit : clauses[p]) {
+            if ((uint) abs(lit) != var) {
+                mark[index(lit)] = true;
+                out.push_back(lit);
+            }
+        }
+        bool tautology = false;
+        for (int lit : clauses[n]) {
+            if ((uint) abs(lit) == var || mark[index(lit)])
+                continue;
+            if (mark[index(-lit)]) {
+                tautology = true;
+                break;
+            }
+            out.push_back(lit);
+        }
+        for (int lit : clauses[p])
+            mark[index(lit)] = false;
+        return ! tautology;
+    }
+
+    // Eliminate var if it has no more resolvents than clauses. Returns false on unsatisfiability.
+    bool eliminate(uint var, bool & done) {
+        done = false;
+        if (S.frozen[var] || S.eliminated[var] || S.defined(var))
+            return true;
+        auto pos = occurrences(var), neg = occurrences(-(int) var);
+        if (pos.empty() && neg.empty())
+            return true;
+        vector<int> resolvent;
+        uint num = 0;
+        for (uint p : pos) {
+            for (uint n : neg) {
+                if (! resolve(p, n, var, resolvent))
+                    continue;
+                if (resolvent.size() > ELIM_MAX_RESOLVENT || ++num > pos.size() + neg.size())
+                    return true;
+            }
+        }
+        for (uint p : pos) {
+            for (uint n : neg) {
+                if (! resolve(p, n, var, resolvent))
+                    continue;
+                if (S.proof)
+                    S.proof->add(resolvent.data(), resolvent.size());
+                if (resolvent.empty())
+                    return false;
+                add(move(resolvent));
+            }
+        }
+        for (auto list : { &pos, &neg }) {
+            int pivot = list == &pos ? (int) var : -(int) var;
+            for (uint i : *list) {
+                S.elim_stack.push_back(pivot);
+                for (int lit : clauses[i]) {
+                    if (lit != pivot)
+                        S.elim_stack.push_back(lit);
+                }
+                S.elim_stack.push_back(clauses[i].size());
+                remove(i);
+            }
+        }
+        S.eliminated[var] = true;
+        STAT(++S.stats.eliminated_vars);
+        done = true;
+        return subsume();
+    }
+
+    // Try every variable, fewest occurrences first, until a round eliminates nothing.
+    bool eliminate_all() {
+        vector<pair<uint, uint>> order;
+        bool progress = true;
+        while (progress && budget > 0) {
+            progress = false;
+            order.clear();
+            for (uint v = 1; v <= S.N; ++v) {
+                if (! S.frozen[v] && ! S.eliminated[v] && ! S.defined(v))
+                    order.emplace_back(occ[index(v)].size() + occ[index(-(int) v)].size(), v);
+            }
+            sort(order.begin(), order.end());
+            for (auto [_, v] : order) {
+                if (budget <= 0)
+                    break;
+                bool done;
+                if (! eliminate(v, done))
+                    return false;
+                progress |= done;
+            }
+        }
+        return true;
+    }
+};
+
+void solver::freeze(uint var) {
+    while (var > N)
+        new_var();
+    frozen[var] = true;
+}
+
+// Run `preprocessor` on the clauses at level 0 and replace them with its result. Called before the first search,
+// when there are no learnt clauses yet. Returns false on unsatisfiability.
+bool solver::preprocess() {
+    TIME_PHASE(PHASE_PREPROCESS);
+    simplify();
+    preprocessor P(*this);
+    for (uint v = 1; v <= N; ++v) {
+        for (int a : { (int) v, -(int) v }) {
+            for (int b : bin_list(a)) {
+                if (preprocessor::index(a) < preprocessor::index(b) && ev(abs(a)) != a && ev(abs(b)) != b)
+                    P.add({ a, b });
+            }
+        }
+    }
+    for (auto r : db[TIER_CORE]) {
+        auto c = deref(r);
+        P.add(vector<int>(c->lits, c->lits + c->num_lit));
+    }
+    bool res = P.subsume() && P.eliminate_all();
+    for (uint v = 1; v <= N; ++v) { // level 0 reasons would point into the rebuilt arena
+        if (vars[v].reason < CARD_REASON)
+            vars[v].reason = NO_CLAUSE;
+    }
+    arena.clear();
+    arena_wasted = 0;
+    for (auto lists : { &pos_list, &neg_list }) {
+        for (auto & wlist : *lists)
+            wlist.clear();
+    }
+    for (auto lists : { &pos_bin, &neg_bin }) {
+        for (auto & blist : *lists)
+            blist.clear();
+    }
+    db[TIER_CORE].clear();
+    rebuild_queue();
+    if (! res)
+        return ok = false;
+    for (uint i = 0; i < P.clauses.size() && ok; ++i) {
+        if (! P.removed[i])
+            attach(P.clauses[i].data(), P.clauses[i].size(), 0, -1);
+    }
+    return ok;
+}
+
+// Give the eliminated variables values that satisfy the clauses they were eliminated with, undoing the eliminations
+// in reverse order.
+void solver::extend_model() {
+    for (uint v = 1; v <= N; ++v) {
+        if (eliminated[v])
+            model[v] = MODEL_DEFINED;
+    }
+    for (uint i = elim_stack.size(); i > 0;) {
+        uint size = elim_stack[--i];
+        i -= size;
+        bool satisfied = false;
+        for (uint j = i; j < i + size && ! satisfied; ++j)
+            satisfied = ev(abs(elim_stack[j])) == elim_stack[j];
+        if (! satisfied)
+            model[abs(elim_stack[i])] = elim_stack[i] > 0 ? MODEL_DEFINED | MODEL_PHASE : MODEL_DEFINED;
+    }
+    extended = true;
+}
+
+// Make the eliminated variables unassigned again before the clauses or assumptions change.
+void solver::retract_model() {
+    for (uint v = 1; v <= N; ++v) {
+        if (eliminated[v])
+            model[v] &= ~MODEL_DEFINED;
+    }
+    extended = false;
+}
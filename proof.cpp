@@ -0,0 +1,103 @@
+#include "proof.h"
+#include <cstdlib>
+
+using namespace std;
+
+proof_writer::proof_writer(FILE * file, bool binary, bool background) : file(file), binary(binary) {
+    buf.reserve(PROOF_BUFFER_SIZE + 4096);
+    if (background)
+        writer = thread([this] { run(); });
+}
+
+proof_writer::~proof_writer() {
+    {
+        unique_lock<mutex> lock(buf_mutex);
+        if (writer.joinable()) {
+            drain(lock);
+            done = true;
+            cv.notify_all();
+        } else {
+            fwrite(buf.data(), 1, buf.size(), file);
+        }
+    }
+    if (writer.joinable())
+        writer.join();
+    fflush(file);
+}
+
+void proof_writer::add(const int * lits, unsigned num_lit, bool negate) {
+    step('a', lits, num_lit, negate);
+}
+
+void proof_writer::remove(const int * lits, unsigned num_lit) {
+    step('d', lits, num_lit, false);
+}
+
+void proof_writer::step(char kind, const int * lits, unsigned num_lit, bool negate) {
+    unique_lock<mutex> lock(buf_mutex);
+    if (binary) {
+        buf.push_back(kind);
+        for (unsigned i = 0; i < num_lit; ++i) {
+            int lit = negate ? -lits[i] : lits[i];
+            unsigned u = 2 * abs(lit) + (lit < 0);
+            while (u > 127) {
+                buf.push_back(0x80 | (u & 127));
+                u >>= 7;
+            }
+            buf.push_back(u);
+        }
+        buf.push_back(0);
+    } else {
+        if (kind == 'd') {
+            buf.push_back('d');
+            buf.push_back(' ');
+        }
+        for (unsigned i = 0; i < num_lit; ++i) {
+            int lit = negate ? -lits[i] : lits[i];
+            char tmp[12];
+            char * p = tmp + sizeof(tmp);
+            unsigned u = abs(lit);
+            do {
+                *--p = '0' + u % 10;
+                u /= 10;
+            } while (u != 0);
+            if (lit < 0)
+                *--p = '-';
+            buf.insert(buf.end(), p, tmp + sizeof(tmp));
+            buf.push_back(' ');
+        }
+        buf.push_back('0');
+        buf.push_back('\n');
+    }
+    if (buf.size() >= PROOF_BUFFER_SIZE) {
+        if (writer.joinable()) {
+            drain(lock);
+        } else {
+            fwrite(buf.data(), 1, buf.size(), file);
+            buf.clear();
+        }
+    }
+}
+
+// Hand `buf` over to the writer thread, waiting until it has taken the previous one.
+void proof_writer::drain(unique_lock<mutex> & lock) {
+    cv.wait(lock, [&] { return pending.empty(); });
+    pending.swap(buf);
+    cv.notify_all();
+}
+
+void proof_writer::run() {
+    vector<char> out;
+    unique_lock<mutex> lock(buf_mutex);
+    while (1) {
+        cv.wait(lock, [&] { return ! pending.empty() || done; });
+        if (pending.empty())
+            return;
+        out.swap(pending);
+        cv.notify_all();
+        lock.unlock();
+        fwrite(out.data(), 1, out.size(), file);
+        out.clear();
+        lock.lock();
+    }
+}
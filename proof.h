@@ -0,0 +1,32 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define PROOF_BUFFER_SIZE (1 << 20) // bytes collected before they go to the file
+
+// DRUP/DRAT proof output. Steps are encoded into a large buffer, either as text or in the binary DRAT format ('a'
+// or 'd' followed by variable-byte literals and a 0 byte). A full buffer is written by the caller, or handed to a
+// background thread so that the search never waits for the disk. Steps may come from several threads.
+struct proof_writer {
+    proof_writer(FILE * file, bool binary, bool background);
+    ~proof_writer(); // writes out everything
+    void add(const int * lits, unsigned num_lit, bool negate = false); // negate: add the negation of a cube
+    void remove(const int * lits, unsigned num_lit);
+
+    FILE * file;
+    bool binary;
+    std::mutex buf_mutex;
+    std::condition_variable cv;
+    std::vector<char> buf; // being filled
+    std::vector<char> pending; // waiting for `writer`
+    bool done = false;
+    std::thread writer;
+
+    void step(char kind, const int * lits, unsigned num_lit, bool negate);
+    void drain(std::unique_lock<std::mutex> & lock);
+    void run();
+};
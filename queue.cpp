@@ -0,0 +1,157 @@
+#include "solver.h"
+#include <algorithm>
+
+using namespace std;
+
+#define ACTIVITY_RESCALE_LIMIT (1e100)
+
+// The decision queue, in one of two forms. VSIDS keeps the variables in a 4-ary max-heap on activity; the nodes hold
+// a copy of the activity, so sifting reads a single array, and the four children of a node are adjacent. Assigned
+// variables leave the heap lazily, when they come to the top. VMTF keeps all variables in a list in the order they
+// were last bumped, and decides the most recently bumped unassigned one.
+
+void solver::heap_up(uint i) {
+    auto node = heap[i];
+    while (i != 1) {
+        uint parent = (i + 2) / 4;
+        if (heap[parent].activity >= node.activity)
+            break;
+        heap[i] = heap[parent];
+        heap_index[heap[i].var] = i;
+        i = parent;
+    }
+    heap[i] = node;
+    heap_index[node.var] = i;
+}
+void solver::heap_down(uint i) {
+    auto node = heap[i];
+    uint size = heap.size();
+    while (4 * i - 2 < size) {
+        uint first = 4 * i - 2, best = first; // children are first .. first + 3
+        for (uint k = first + 1; k < first + 4 && k < size; ++k) {
+            if (heap[best].activity < heap[k].activity)
+                best = k;
+        }
+        if (heap[best].activity <= node.activity)
+            break;
+        heap[i] = heap[best];
+        heap_index[heap[i].var] = i;
+        i = best;
+    }
+    heap[i] = node;
+    heap_index[node.var] = i;
+}
+void solver::heap_push(uint v) {
+    heap.push_back({ activity[v], v });
+    heap_up(heap.size() - 1);
+}
+void solver::heap_pop() {
+    heap_index[heap[1].var] = 0;
+    heap[1] = heap.back();
+    heap.pop_back();
+    if (heap.size() > 1)
+        heap_down(1);
+}
+
+void solver::queue_append(uint v) { // as the most recently bumped
+    queue_prev[v] = queue_last;
+    queue_next[v] = 0;
+    if (queue_last != 0)
+        queue_next[queue_last] = v;
+    queue_last = v;
+    queue_stamp[v] = ++num_queue_stamps;
+}
+void solver::queue_remove(uint v) {
+    uint prev = queue_prev[v], next = queue_next[v];
+    if (prev != 0)
+        queue_next[prev] = next;
+    if (next != 0)
+        queue_prev[next] = prev;
+    else
+        queue_last = prev;
+}
+
+// Add a new, unassigned variable.
+void solver::enqueue_var(uint v) {
+    if (vmtf) {
+        queue_append(v);
+        queue_search = v;
+    } else {
+        heap_push(v);
+    }
+}
+
+// The unassigned variable to decide next, or 0 if there is none. It stays in the queue.
+uint solver::next_decision() {
+    if (vmtf) {
+        uint v = queue_search;
+        while (v != 0 && (defined(v) || eliminated[v]))
+            v = queue_prev[v];
+        queue_search = v;
+        return v;
+    }
+    while (heap.size() > 1 && defined(heap[1].var))
+        heap_pop();
+    return heap.size() > 1 ? heap[1].var : 0;
+}
+
+// Of two unassigned variables, the queue picks the one of higher priority first.
+double solver::priority(uint v) {
+    return vmtf ? queue_stamp[v] : activity[v];
+}
+
+int solver::choose() {
+    uint v = next_decision();
+    if (v == 0)
+        return 0;
+    if (! vmtf)
+        heap_pop(); // it is pushed again when unassigned
+    return phase(v) ? (int) v : -(int) v;
+}
+
+// Bump the variables `analyze` collected. VMTF moves them to the front of the list, keeping their relative order;
+// VSIDS rescales the activities at most once per conflict.
+void solver::bump_variables() {
+    if (vmtf) {
+        sort(bumped.begin(), bumped.end(), [&](uint x, uint y) { return queue_stamp[x] < queue_stamp[y]; });
+        for (uint v : bumped) {
+            queue_remove(v);
+            queue_append(v);
+            if (! defined(v))
+                queue_search = v;
+        }
+        bumped.clear();
+        return;
+    }
+    bool rescale = false;
+    for (uint v : bumped) {
+        activity[v] += activity_increment;
+        rescale |= activity[v] > ACTIVITY_RESCALE_LIMIT;
+        if (heap_index[v] != 0) {
+            heap[heap_index[v]].activity = activity[v];
+            heap_up(heap_index[v]);
+        }
+    }
+    bumped.clear();
+    if (! rescale)
+        return;
+    activity_increment *= (1 / ACTIVITY_RESCALE_LIMIT);
+    for (uint v = 1; v <= N; ++v)
+        activity[v] *= (1 / ACTIVITY_RESCALE_LIMIT);
+    for (uint i = 1; i < heap.size(); ++i) // the same factor keeps the heap order
+        heap[i].activity *= (1 / ACTIVITY_RESCALE_LIMIT);
+}
+
+// Put back into the decision queue exactly the variables that are neither assigned nor eliminated.
+void solver::rebuild_queue() {
+    if (vmtf) {
+        queue_search = queue_last;
+        return;
+    }
+    heap.resize(1);
+    for (uint v = 1; v <= N; ++v) {
+        heap_index[v] = 0;
+        if (! eliminated[v] && ! defined(v))
+            heap_push(v);
+    }
+}
@@ -1,589 +1,726 @@
+#include "exchange.h"
+#include "proof.h"
+#include "solver.h"
 #include <algorithm>
-#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
-#include <optional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 }
 
 using namespace std;
 
+#define CUBE_WARMUP_CONFLICTS 1000 // search before splitting, to give lookahead meaningful activities
+
 bool opt_quiet = false;
+bool opt_verbose = false;
 FILE * opt_cert_file = NULL;
-
-typedef unsigned uint;
-typedef unsigned char uchar;
-
-#define ACTIVITY_DECAY_FACTOR (0.9)
-#define ACTIVITY_RESCALE_LIMIT (1e100)
-#define RESTART_BASE_INTERVAL 10 // can even be 1
-
-uint N; // number of variables
-uint M; // number of initial clauses
-vector<vector<int>> F; // problem
-
-enum {
-    MODEL_DEFINED = 1,
-    MODEL_PHASE = 2,
-};
-vector<uchar> model;
-vector<int> trail; // 0 for decision mark
-uint decision_level;
-enum {
-    CLAUSE_LEARNT = 1,
-    CLAUSE_LOCK = 2,
-};
-struct clause {
-    uint num_lit;
-    int flags;
-    uint score;
-    int lits[]; // lits[0] and lits[1] are watched literals
+bool opt_cert_binary = false;
+bool opt_cert_thread = false;
+uint opt_threads = 1;
+bool opt_batch = false;
+uint64_t opt_conflicts = 0;
+double opt_time = 0;
+uint opt_depth = 0;
+bool opt_preprocess = true;
+bool opt_vmtf = false;
+bool opt_rephase = true;
+bool opt_walk_only = false;
+bool opt_xor = true;
+unique_ptr<proof_writer> proof; // flushed when the program exits
+FILE * opt_stats_file = NULL;
+auto start_time = chrono::steady_clock::now();
+double parse_time;
+
+struct cnf {
+    uint num_vars = 0;
+    vector<int> lits; // literals of all clauses, laid out contiguously
+    vector<uint> start { 0 }; // clause i is lits[start[i]] .. lits[start[i + 1] - 1]
+    uint size() const {
+        return start.size() - 1;
+    }
+    const int * begin(uint i) const {
+        return lits.data() + start[i];
+    }
+    const int * end(uint i) const {
+        return lits.data() + start[i + 1];
+    }
+    // cardinality constraints: at most card_bound[i] of card_lits[card_start[i]] .. card_lits[card_start[i + 1] - 1]
+    vector<int> card_lits;
+    vector<uint> card_start { 0 };
+    vector<uint> card_bound;
+    uint num_cards() const {
+        return card_bound.size();
+    }
+    // XOR constraints: xor_lits[xor_start[i]] .. xor_lits[xor_start[i + 1] - 1] add up to true
+    vector<int> xor_lits;
+    vector<uint> xor_start { 0 };
+    uint num_xors() const {
+        return xor_start.size() - 1;
+    }
 };
-vector<vector<clause *>> pos_list, neg_list; // watch lists
-vector<uint> level;
-vector<clause *> reason; // nullptr for decision
-vector<bool> seen; // only used in `analyze`
-vector<int> learnt; // only used in `analyze`
-deque<clause *> db; // all clauses; first `db_num_persistent` clauses are persistent
-uint db_num_persistent = 0;
-uint db_limit = 0; // including persistent clauses
-uint backoff_timer = 0;
-uint backoff_limit = 0;
-vector<double> activity; // variable activity
-vector<uint> heap; // priority queue for variable selection
-vector<uint> heap_index; // variable to index in heap; 0 if variable not in heap
-double activity_increment = 1;
-uint restart_timer = 0;
-uint restart_limit = RESTART_BASE_INTERVAL;
-array<int, 2> luby_seq { 1, 1 }; // reluctant doubling
-vector<uint> decision; // for parital restarts
-vector<pair<uint, bool>> stack; // only used in `analyze`
-vector<uint> trash; // only used in `analyze`
-
-bool defined(uint var) {
-    return (model[var] & MODEL_DEFINED) != 0;
-}
-bool phase(uint var) {
-    return (model[var] & MODEL_PHASE) != 0;
-}
-int ev(uint var) {
-    return ! defined(var) ? 0 : phase(var) ? (int) var : -(int) var;
-}
 
-bool heap_compare(uint i, uint j) {
-    return activity[heap[i]] < activity[heap[j]];
-}
-void heap_swap(uint i, uint j) {
-    heap_index[heap[i]] = j;
-    heap_index[heap[j]] = i;
-    swap(heap[i], heap[j]);
-}
-uint heap_up(uint i) {
-    while (i != 1 && heap_compare(i / 2, i)) {
-        heap_swap(i / 2, i);
-        i = i / 2;
+void check_model(const cnf & F, const solver & S) {
+    for (uint k = 0; k < F.size(); ++k) {
+        bool found = false;
+        for (auto p = F.begin(k); p != F.end(k); ++p) {
+            int lit = *p;
+            if (S.value(abs(lit)) == lit) {
+                found = true;
+                break;
+            }
+        }
+        if (! found) {
+            fputs("model broken!\n", stderr);
+            exit(2);
+        }
     }
-    return i;
-}
-uint heap_down(uint i) {
-    while (2 * i < heap.size()) {
-        uint k = 2 * i;
-        if (k + 1 < heap.size() && heap_compare(k, k + 1)) {
-            k = k + 1; // take greater child
+    for (uint k = 0; k < F.num_cards(); ++k) {
+        uint num_true = 0;
+        for (uint i = F.card_start[k]; i < F.card_start[k + 1]; ++i) {
+            if (i == F.card_start[k] || F.card_lits[i] != F.card_lits[i - 1]) // sorted; a repeat counts once
+                num_true += S.value(abs(F.card_lits[i])) == F.card_lits[i];
+        }
+        if (num_true > F.card_bound[k]) {
+            fputs("model broken!\n", stderr);
+            exit(2);
+        }
+    }
+    for (uint k = 0; k < F.num_xors(); ++k) {
+        bool sum = false;
+        for (uint i = F.xor_start[k]; i < F.xor_start[k + 1]; ++i)
+            sum ^= S.value(abs(F.xor_lits[i])) == F.xor_lits[i];
+        if (! sum) {
+            fputs("model broken!\n", stderr);
+            exit(2);
         }
-        if (! heap_compare(i, k))
-            break;
-        heap_swap(i, k);
-        i = k;
     }
-    return i;
-}
-bool heap_empty() {
-    return heap.size() == 0;
-}
-uint heap_top() {
-    return heap[1];
-}
-void heap_push(uint v) {
-    heap.push_back(v);
-    heap_index[v] = heap.size() - 1;
-    heap_up(heap.size() - 1);
-}
-void heap_pop() {
-    heap_swap(1, heap.size() - 1);
-    uint v = heap.back();
-    heap.pop_back();
-    heap_index[v] = 0;
-    heap_down(1);
 }
 
-void push(int lit, clause * c) {
-    uint var = abs(lit);
-    model[var] = lit > 0 ? MODEL_DEFINED | MODEL_PHASE : MODEL_DEFINED;
-    level[var] = decision_level;
-    reason[var] = c;
-    if (c)
-        c->flags |= CLAUSE_LOCK;
-    trail.push_back(lit);
-    // var is lazily removed from heap
-}
-void pop() {
-    int lit = trail.back();
-    uint var = abs(lit);
-    model[var] &= ~MODEL_DEFINED;
-    auto c = reason[var];
-    if (c)
-        c->flags &= ~CLAUSE_LOCK;
-    if (heap_index[var] == 0)
-        heap_push(var);
-    trail.pop_back();
+void configure(solver & s) {
+    s.conflict_budget = opt_conflicts;
+    s.time_budget = opt_time;
+    s.preprocessing = opt_preprocess;
+    s.inprocessing = opt_preprocess;
+    s.vmtf = opt_vmtf;
+    s.rephasing = opt_rephase;
+    s.walk_only = opt_walk_only;
+    s.xor_detection = opt_xor;
+}
+
+void load(solver & s, const cnf & F) {
+    while (s.num_vars() < F.num_vars)
+        s.new_var();
+    for (uint i = 0; i < F.size(); ++i)
+        s.add_clause(F.begin(i), F.end(i) - F.begin(i));
+    for (uint i = 0; i < F.num_cards(); ++i)
+        s.add_at_most(&F.card_lits[F.card_start[i]], F.card_start[i + 1] - F.card_start[i], F.card_bound[i]);
+    for (uint i = 0; i < F.num_xors(); ++i)
+        s.add_xor(&F.xor_lits[F.xor_start[i]], F.xor_start[i + 1] - F.xor_start[i]);
+}
+
+void print_model(const cnf & F, const solver & S) {
+    printf("v ");
+    for (uint v = 1; v <= F.num_vars; ++v) {
+        if (S.value(v))
+            printf("%d ", S.value(v));
+    }
+    puts("0");
+}
+
+// Solve F with differently configured solvers in parallel threads, sharing short learnt clauses among them.
+// The first one to finish stops the others; its index is stored in `winner`.
+result solve_portfolio(const cnf & F, vector<solver> & solvers, uint & winner) {
+    static const uint restart_bases[] = { RESTART_BASE_INTERVAL, 50, 100, 25 };
+    static const double decays[] = { ACTIVITY_DECAY_FACTOR, 0.95, 0.85, 0.92 };
+    clause_exchange exchange;
+    atomic<bool> stop { false };
+    atomic<int> first { -1 };
+    vector<result> results(solvers.size());
+    vector<thread> threads;
+    for (uint i = 0; i < solvers.size(); ++i) {
+        auto & s = solvers[i];
+        configure(s);
+        s.seed = i; // solver 0 runs the default configuration
+        s.luby_restarts = i % 4 >= 2;
+        s.restart_base = restart_bases[i % 4];
+        s.activity_decay = decays[i / 4 % 4];
+        s.initial_phase = i % 2 == 1;
+        s.proof = proof.get();
+        s.cert_deletions = false;
+        s.interrupt = &stop;
+        s.exchange = &exchange;
+        s.exchange_id = i;
+        threads.emplace_back([&, i] {
+            load(solvers[i], F);
+            results[i] = solvers[i].solve();
+            int none = -1;
+            if (results[i] != UNKNOWN && first.compare_exchange_strong(none, i))
+                stop = true;
+        });
+    }
+    for (auto & t : threads)
+        t.join();
+    winner = max(first.load(), 0); // every solver may have run out of budget
+    return results[winner];
+}
+
+// Cube and conquer: solver 0 splits F into cubes by lookahead, then every solver takes cubes from a shared counter
+// and solves F under them as assumptions. The first model stops the run; F is unsatisfiable once every cube is refuted.
+result solve_cubes(const cnf & F, vector<solver> & solvers, uint & winner) {
+    for (auto & s : solvers) {
+        configure(s);
+        s.proof = proof.get();
+        s.cert_deletions = false;
+        s.preprocessing &= &s == &solvers[0]; // the cubes may contain any variable the others would eliminate
+    }
+    auto & s0 = solvers[0];
+    load(s0, F);
+    s0.conflict_budget = CUBE_WARMUP_CONFLICTS;
+    result res = s0.solve();
+    s0.conflict_budget = opt_conflicts;
+    if (res != UNKNOWN)
+        return res;
+    vector<vector<int>> cubes, nodes;
+    s0.make_cubes(opt_depth, cubes, nodes);
+    if (opt_verbose)
+        printf("c cubes: %zu, inner nodes: %zu\n", cubes.size(), nodes.size());
+
+    atomic<bool> stop { false };
+    atomic<uint> next { 0 };
+    atomic<int> first { -1 };
+    atomic<bool> refuted { false }; // F itself was refuted
+    atomic<bool> unknown { false }; // some cube ran out of budget
+    vector<thread> threads;
+    for (uint i = 0; i < solvers.size(); ++i) {
+        threads.emplace_back([&, i] {
+            auto & s = solvers[i];
+            if (i > 0)
+                load(s, F);
+            // Inprocessing freezes only the cube being solved; later cubes must not lose variables to it either.
+            for (auto & cube : cubes) {
+                for (int lit : cube)
+                    s.freeze(abs(lit));
+            }
+            s.interrupt = &stop;
+            while (! stop) {
+                uint k = next++;
+                if (k >= cubes.size())
+                    break;
+                result res = s.solve(cubes[k]);
+                if (res == SATISFIABLE) {
+                    int none = -1;
+                    first.compare_exchange_strong(none, i);
+                    stop = true;
+                } else if (res == UNSATISFIABLE && s.core.empty()) {
+                    refuted = true;
+                    stop = true;
+                } else if (res == UNSATISFIABLE) {
+                    if (proof)
+                        proof->add(s.core.data(), s.core.size(), true);
+                } else if (! stop) {
+                    unknown = true;
+                }
+            }
+        });
+    }
+    for (auto & t : threads)
+        t.join();
+    if (first >= 0) {
+        winner = first;
+        return SATISFIABLE;
+    }
+    if (refuted)
+        return UNSATISFIABLE;
+    if (unknown)
+        return UNKNOWN;
+    if (proof) { // the empty root is left to `main`
+        for (uint i = 0; i + 1 < nodes.size(); ++i)
+            proof->add(nodes[i].data(), nodes[i].size(), true);
+    }
+    return UNSATISFIABLE;
 }
 
-clause * make_clause(const vector<int> & lits, int flags, uint score) {
-    clause * c = reinterpret_cast<clause *>(malloc(sizeof(clause) + sizeof(int) * lits.size()));
-    c->num_lit = lits.size();
-    for (uint i = 0; i < lits.size(); ++i)
-        c->lits[i] = lits[i];
-    c->flags = flags;
-    c->score = score;
-    return c;
+[[noreturn]] void parse_error(const char * msg) {
+    fprintf(stderr, "parse error: %s\n", msg);
+    exit(1);
 }
 
-auto & watch_list(int lit) {
-    return lit > 0 ? pos_list[lit] : neg_list[-lit];
-}
-void watch_clause(clause * c) {
-    for (auto i : { 0, 1 }) {
-        watch_list(c->lits[i]).push_back(c);
+// Stdin is mapped when it is a regular file. Otherwise (e.g. a pipe) it is read in chunks on demand,
+// so that the parser never asks for more than the declared clauses.
+int in_fd;
+const char * in_ptr;
+const char * in_end;
+void * in_map = nullptr; // the mapping of the previous input is released by the next `open_input`
+size_t in_map_size;
+vector<char> in_buf;
+
+void open_input(int fd) {
+    if (in_map) {
+        munmap(in_map, in_map_size);
+        in_map = nullptr;
+    }
+    in_fd = fd;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            in_map = p;
+            in_map_size = st.st_size;
+            in_ptr = static_cast<const char *>(p);
+            in_end = in_ptr + st.st_size;
+            return;
+        }
     }
+    in_buf.resize(1 << 16);
+    in_ptr = in_end = in_buf.data();
 }
-void unwatch_clause(clause * c) {
-    for (auto i : { 0, 1 }) {
-        auto & wlist = watch_list(c->lits[i]);
-        for (auto & wc : wlist) {
-            if (wc == c) {
-                wc = wlist.back();
-                wlist.pop_back();
-                break;
-            }
+bool refill() {
+    if (in_map)
+        return false;
+    ssize_t n;
+    while ((n = read(in_fd, in_buf.data(), in_buf.size())) < 0) {
+        if (errno != EINTR) {
+            perror("could not read input");
+            exit(1);
         }
     }
+    in_ptr = in_buf.data();
+    in_end = in_ptr + n;
+    return n > 0;
+}
+int peek() {
+    return in_ptr != in_end || refill() ? (uchar) *in_ptr : EOF;
 }
 
-void bump_activity(uint v) {
-    activity[v] += activity_increment;
-    if (activity[v] > ACTIVITY_RESCALE_LIMIT) { // rescore
-        activity_increment *= (1 / ACTIVITY_RESCALE_LIMIT);
-        for (uint v = 1; v <= N; ++v)
-            activity[v] *= (1 / ACTIVITY_RESCALE_LIMIT);
-    }
-    if (heap_index[v] != 0)
-        heap_up(heap_index[v]);
+bool is_space(int c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
 }
-void decay_activity() {
-    activity_increment *= (1 / ACTIVITY_DECAY_FACTOR);
+void skip_space() {
+    while (is_space(peek()))
+        ++in_ptr;
 }
-
-void backjump(uint level) {
-    while (decision_level != level) {
-        for (uint i = trail.size() - 1; trail[i] != 0; --i)
-            pop();
-        trail.pop_back(); // remove the mark
-        --decision_level;
+void skip_line() {
+    int c;
+    while ((c = peek()) != EOF) {
+        ++in_ptr;
+        if (c == '\n')
+            break;
     }
 }
-
-void update_score(clause * c) {
-    uint lbd = 0;
-    for (uint i = 0; i < c->num_lit; ++i) {
-        int lit = c->lits[i];
-        auto lv = level[abs(lit)];
-        if (seen[lv])
+uint parse_uint() {
+    uint n = 0;
+    int c = peek();
+    if (uint(c - '0') > 9)
+        parse_error("number expected");
+    do {
+        uint d = c - '0';
+        if (n > (UINT_MAX - d) / 10) // it would wrap around to a different number
+            parse_error("number out of range");
+        n = n * 10 + d;
+        ++in_ptr;
+    } while (uint((c = peek()) - '0') <= 9);
+    return n;
+}
+
+// The clauses of the binary format written by `cnf_writer` (see sink.h), after the rest of the header line.
+void parse_binary(cnf & F, uint M) {
+    while (peek() == ' ')
+        ++in_ptr;
+    if (peek() != '\n')
+        parse_error("newline expected");
+    ++in_ptr;
+    while (F.size() < M) {
+        uint u = 0;
+        int c;
+        for (uint shift = 0;; shift += 7) {
+            if ((c = peek()) == EOF)
+                parse_error("unexpected end of input");
+            ++in_ptr;
+            if (shift > 28 || (shift == 28 && (c & 127) > 15)) // more than 32 bits
+                parse_error("literal out of range");
+            u |= (c & 127) << shift;
+            if ((c & 128) == 0)
+                break;
+        }
+        if (u == 0) {
+            F.start.push_back(F.lits.size());
             continue;
-        seen[lv] = true;
-        trash.push_back(lv);
-        ++lbd;
-    }
-    c->score = lbd;
-    for (auto lv : trash)
-        seen[lv] = false;
-    trash.clear();
+        }
+        if (u / 2 == 0 || u / 2 > F.num_vars)
+            parse_error("variable out of range");
+        F.lits.push_back((u & 1) != 0 ? -(int) (u / 2) : (int) (u / 2));
+    }
 }
 
-void analyze(clause * conflict) {
-    learnt.push_back(0); // reserve learnt[0] for UIP
-    uint count = 0;
-    for (uint i = 0; i < conflict->num_lit; ++i) {
-        int lit = conflict->lits[i];
-        uint v = abs(lit);
-        uint lv = level[v];
-        if (lv == 0)
+// Read the next DIMACS problem into F, in text or in the binary format of sink.h ("p bcnf"); false if the input ends
+// before its header. Literals go into one flat buffer, so there is no allocation per clause. Text may also hold
+// cardinality constraints as in MiniCard: literals followed by "<= K" or ">= K" instead of 0, and XOR constraints as
+// in CryptoMiniSat: "x" and then literals that add up to true, such as "x1 -2 3 0"; both are counted as clauses.
+bool parse_cnf(cnf & F) {
+    int c;
+    while (skip_space(), (c = peek()) == 'c' || c == '%' || c == '0') // SATLIB files end with "%" and "0" lines
+        skip_line();
+    if (peek() == EOF)
+        return false;
+    if (peek() != 'p')
+        parse_error("'p cnf' expected");
+    ++in_ptr;
+    skip_space();
+    bool binary = peek() == 'b';
+    in_ptr += binary;
+    for (auto c : { 'c', 'n', 'f' }) {
+        if (peek() != c)
+            parse_error("'p cnf' expected");
+        ++in_ptr;
+    }
+    skip_space();
+    uint N = F.num_vars = parse_uint();
+    if (N > INT_MAX) // literals are ints
+        parse_error("number of variables out of range");
+    skip_space();
+    uint M = parse_uint();
+    F.lits.reserve(3 * M);
+    F.start.reserve(M + 1);
+    if (binary) {
+        parse_binary(F, M);
+        return true;
+    }
+    bool in_xor = false;
+    while (F.size() + F.num_cards() + F.num_xors() < M) { // do not read past the last clause; a pipe may be kept open
+        skip_space();
+        c = peek();
+        if (c == EOF)
+            break;
+        if (c == 'c') {
+            skip_line();
             continue;
-        seen[v] = true;
-        if (lv < decision_level) {
-            learnt.push_back(lit);
-        } else {
-            ++count;
         }
-        bump_activity(v);
-    }
-    int uip;
-    for (uint i = trail.size() - 1; true; --i) {
-        int lit = trail[i];
-        uint v = abs(lit);
-        if (! seen[v])
+        if (c == 'x' && F.start.back() == F.lits.size()) {
+            ++in_ptr;
+            in_xor = true;
             continue;
-        seen[v] = false;
-        --count;
-        if (count == 0) {
-            uip = lit;
-            break;
         }
-        auto c = reason[v];
-        for (uint i = 1; i < c->num_lit; ++i) {
-            int lit = c->lits[i];
-            uint v = abs(lit);
-            if (seen[v])
-                continue;
-            uint lv = level[v];
-            if (lv == 0)
-                continue;
-            seen[v] = true;
-            if (lv < decision_level) {
-                learnt.push_back(lit);
-            } else {
-                ++count;
+        if (c == '<' || c == '>') { // the literals read so far form a cardinality constraint
+            ++in_ptr;
+            if (peek() != '=')
+                parse_error("'<=' or '>=' expected");
+            ++in_ptr;
+            skip_space();
+            uint bound = parse_uint();
+            auto begin = F.lits.begin() + F.start.back();
+            sort(begin, F.lits.end()); // the literals are a set; repeats stay next to each other for the solver to drop
+            if (c == '>') { // at least bound of the literals: at most size - bound of their negations
+                F.lits.erase(unique(begin, F.lits.end()), F.lits.end());
+                uint size = F.lits.size() - F.start.back();
+                for (uint i = F.start.back(); i < F.lits.size(); ++i)
+                    F.lits[i] = -F.lits[i];
+                bound = bound <= size ? size - bound : -1u;
             }
-            bump_activity(v);
-        }
-    }
-    learnt[0] = -uip;
-    // minimize clause
-    for (uint i = 1; i < learnt.size(); ++i) {
-        bool subsume = true;
-        uint v = abs(learnt[i]);
-        stack.push_back({ v, true });
-        while (! stack.empty()) {
-            auto [v, cont] = stack.back();
-            stack.pop_back();
-            if (! cont) {
-                if (! seen[v]) {
-                    seen[v] = true; // v is removable
-                    trash.push_back(v);
-                }
+            if (bound == -1u) { // more than all of them; an empty clause says the same
+                F.lits.resize(F.start.back());
+                F.start.push_back(F.lits.size());
                 continue;
             }
-            auto c = reason[v];
-            if (! c) {
-                subsume = false;
-                break;
-            }
-            stack.push_back({ v, false });
-            for (uint i = 1; i < c->num_lit; ++i) {
-                uint v = abs(c->lits[i]);
-                if (! (seen[v] || level[v] == 0))
-                    stack.push_back({ v, true });
-            }
-        }
-        if (subsume) {
-            seen[v] = false;
-            learnt[i] = learnt.back();
-            learnt.pop_back();
-            --i;
-        }
-        stack.clear();
-    }
-    for (uint v : trash) {
-        seen[v] = false;
-    }
-    trash.clear();
-    uint num_lit = learnt.size();
-    for (uint i = 1; i < num_lit; ++i)
-        seen[abs(learnt[i])] = false;
-    if (opt_cert_file) {
-        for (auto lit : learnt) {
-            fprintf(opt_cert_file, "%d ", lit);
-        }
-        fputs("0\n", opt_cert_file);
-    }
-    uint max_lv = 0;
-    for (uint i = 1; i < num_lit; ++i) {
-        uint lv = level[abs(learnt[i])];
-        if (lv > max_lv) {
-            max_lv = lv;
-            swap(learnt[1], learnt[i]);
-        }
-    }
-    backjump(max_lv);
-    if (num_lit == 1) {
-        push(-uip, nullptr);
-        learnt.clear();
-        return;
-    }
-    // learn new clause
-    auto c = make_clause(learnt, CLAUSE_LEARNT, 0);
-    update_score(c);
-    push(-uip, c);
-    learnt.clear();
-    if (num_lit == 2 || c->score <= 2) {
-        db.push_front(c);
-        ++db_num_persistent;
-    } else {
-        db.push_back(c);
-    }
-    watch_clause(c);
-}
-
-optional<clause *> find_conflict() {
-    for (uint prop = trail.size() - 1; prop < trail.size(); ++prop) {
-        int lit = trail[prop];
-        auto & wlist = watch_list(-lit);
-        for (uint i = 0; i < wlist.size(); ++i) {
-            auto c = wlist[i];
-            if (c->lits[0] == -lit)
-                swap(c->lits[0], c->lits[1]);
-            int lit = c->lits[0];
-            if (ev(abs(lit)) == lit) // satisfied
-                continue;
-            for (uint k = 2; k < c->num_lit; ++k) {
-                int lit = c->lits[k];
-                if (ev(abs(lit)) != -lit) { // update watch list
-                    watch_list(lit).push_back(c);
-                    swap(c->lits[1], c->lits[k]);
-                    wlist[i] = wlist.back();
-                    wlist.pop_back();
-                    --i;
-                    goto next;
-                }
-            }
-            if (defined(abs(lit)))
-                return c; // conflict found
-            update_score(c);
-            push(lit, c);
-        next:;
-        }
-    }
-    return nullopt; // no conflict found
-}
-
-int choose() {
-    while (! heap_empty()) {
-        uint v = heap_top();
-        heap_pop();
-        if (! defined(v)) {
-            return phase(v) ? (int) v : -(int) v;
+            F.card_lits.insert(F.card_lits.end(), F.lits.begin() + F.start.back(), F.lits.end());
+            F.card_start.push_back(F.card_lits.size());
+            F.card_bound.push_back(bound);
+            F.lits.resize(F.start.back());
+            continue;
         }
-    }
-    return 0;
-}
-
-int decide() {
-    int lit;
-    if ((lit = choose()) == 0)
-        return false; // sat
-    trail.push_back(0); // push mark
-    ++decision_level;
-    decision[decision_level] = abs(lit);
-    push(lit, nullptr);
-    return true;
-}
-
-void reduce() {
-    if (db.size() < db_limit)
-        return;
-    sort(db.begin() + db_num_persistent, db.end(), [](auto x, auto y) {
-        return x->score < y->score;
-    });
-    uint new_size = db_num_persistent + (db.size() - db_num_persistent) / 2;
-    for (uint i = new_size; i < db.size(); ++i) {
-        if ((db[i]->flags & CLAUSE_LOCK) != 0) {
-            db[new_size++] = db[i];
+        bool neg = c == '-';
+        in_ptr += neg;
+        uint var = parse_uint();
+        if (var == 0 && in_xor) {
+            F.xor_lits.insert(F.xor_lits.end(), F.lits.begin() + F.start.back(), F.lits.end());
+            F.xor_start.push_back(F.xor_lits.size());
+            F.lits.resize(F.start.back());
+            in_xor = false;
             continue;
         }
-        unwatch_clause(db[i]);
-        if (opt_cert_file) {
-            fputs("d ", opt_cert_file);
-            for (uint i = 0; i < db[i]->num_lit; ++i) {
-                fprintf(opt_cert_file, "%d ", db[i]->lits[i]);
-            }
-            fputs("0\n", opt_cert_file);
+        if (var == 0) {
+            F.start.push_back(F.lits.size());
+            continue;
         }
-        free(db[i]);
-    }
-    db.resize(new_size);
+        if (var > N)
+            parse_error("variable out of range");
+        F.lits.push_back(neg ? -(int) var : (int) var);
+    }
+    if (in_xor) { // last constraint lacks its terminating 0
+        F.xor_lits.insert(F.xor_lits.end(), F.lits.begin() + F.start.back(), F.lits.end());
+        F.xor_start.push_back(F.xor_lits.size());
+        F.lits.resize(F.start.back());
+    }
+    if (F.start.back() != F.lits.size())
+        F.start.push_back(F.lits.size());
+    uint found = F.size() + F.num_cards() + F.num_xors();
+    if (found != M)
+        fprintf(stderr, "warning: %u clauses declared but %u found\n", M, found);
+    return true;
 }
 
-bool restart() {
-    if (restart_timer < restart_limit)
-        return false;
-    luby_seq = {
-        (luby_seq[0] & -luby_seq[0]) == luby_seq[1] ? luby_seq[0] + 1 : luby_seq[0],
-        (luby_seq[0] & -luby_seq[0]) == luby_seq[1] ? 1 : 2 * luby_seq[1]
-    };
-    restart_timer = 0;
-    restart_limit = RESTART_BASE_INTERVAL * luby_seq[1];
-    uint next_var;
+// Batch mode: the main thread parses problems one after another and hands them to a pool of workers, each of which
+// keeps one solver for all the problems it takes.
+struct job {
+    string name;
+    cnf F;
+};
+mutex queue_mutex;
+condition_variable queue_cv;
+deque<job> queue; // bounded, so that a long stream is not held in memory at once
+bool queue_closed = false;
+mutex output_mutex;
+
+void batch_worker() {
+    solver s;
+    configure(s);
     while (1) {
-        if (heap_empty())
-            return false;
-        next_var = heap_top();
-        if (! defined(next_var))
-            break;
-        heap_pop();
-    }
-    auto next_activity = activity[next_var];
-    for (uint level = 0; level < decision_level; ++level) {
-        uint var = decision[level + 1];
-        if (activity[var] < next_activity) {
-            backjump(level);
-            return true;
+        job j;
+        {
+            unique_lock<mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [] { return ! queue.empty() || queue_closed; });
+            if (queue.empty())
+                return;
+            j = move(queue.front());
+            queue.pop_front();
         }
-    }
-    return false;
-}
-
-void simplify() {
-    if (decision_level > 0)
-        return;
-    uint new_size = 0;
-    for (uint i = 0; i < db.size(); ++i) {
-        auto c = db[i];
-        bool satisfied = false;
-        uint new_num_lit = 0;
-        for (uint i = 0; i < c->num_lit; ++i) {
-            int lit = c->lits[i];
-            uint v = abs(lit);
-            if (! defined(v)) {
-                c->lits[new_num_lit++] = lit;
-            } else if (ev(abs(lit)) == lit) {
-                unwatch_clause(c);
-                free(c);
-                satisfied = true;
-                break;
-            }
+        queue_cv.notify_all();
+        auto start = chrono::steady_clock::now();
+        s.reset();
+        load(s, j.F);
+        result res = s.solve();
+        chrono::duration<double> t = chrono::steady_clock::now() - start;
+        if (res == SATISFIABLE)
+            check_model(j.F, s);
+        static const char * names[] = { "UNKNOWN", "SATISFIABLE", "UNSATISFIABLE" };
+        lock_guard<mutex> lock(output_mutex);
+        printf("%s %s %.3f %llu\n", j.name.c_str(), names[res / 10], t.count(), (unsigned long long) s.num_conflicts);
+        if (res == SATISFIABLE && ! opt_quiet)
+            print_model(j.F, s);
+    }
+}
+
+void enqueue(job && j) {
+    unique_lock<mutex> lock(queue_mutex);
+    queue_cv.wait(lock, [] { return queue.size() < 2 * opt_threads; });
+    queue.push_back(move(j));
+    queue_cv.notify_all();
+}
+
+void enqueue_file(const string & path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror(path.c_str());
+        exit(1);
+    }
+    open_input(fd);
+    job j;
+    j.name = path;
+    if (! parse_cnf(j.F))
+        parse_error("'p cnf' expected");
+    enqueue(move(j));
+    close(fd);
+}
+
+// An argument is a DIMACS file, a directory whose *.cnf files are taken in name order, or @LIST for a file that names
+// one problem per line.
+void enqueue_arg(const string & arg) {
+    if (arg[0] == '@') {
+        FILE * fp = fopen(arg.c_str() + 1, "r");
+        if (! fp) {
+            perror(arg.c_str() + 1);
+            exit(1);
         }
-        if (! satisfied) {
-            c->num_lit = new_num_lit;
-            db[new_size++] = c;
+        char * line = nullptr;
+        size_t cap = 0;
+        ssize_t len;
+        while ((len = getline(&line, &cap, fp)) > 0) {
+            while (len > 0 && is_space(line[len - 1]))
+                line[--len] = '\0';
+            if (len > 0)
+                enqueue_file(line);
         }
+        free(line);
+        fclose(fp);
+        return;
     }
-    db.resize(new_size);
-}
-
-bool solve() {
-    srand(0);
-
-    model.resize(N + 1);
-    trail.reserve(2 * N);
-    decision_level = 0;
-    pos_list.resize(N + 1);
-    neg_list.resize(N + 1);
-    level.resize(N + 1);
-    reason.resize(N + 1);
-    seen.resize(N + 1);
-    learnt.reserve(N);
-    db_limit = F.size() * 1.5;
-    backoff_limit = 100;
-    activity.resize(N + 1);
-    heap.reserve(N + 1); // heap[0] is not used
-    heap_index.resize(N + 1);
-    for (uint v = 1; v <= N; ++v)
-        heap_push(v);
-    decision.resize(N + 1);
-    trash.reserve(N);
-
-    vector<int> unit;
-    vector<int> new_lits;
-    for (auto & lits : F) {
-        size_t size = lits.size();
-        if (size == 0)
-            return false; // unsat
-        if (size == 1) {
-            unit.push_back(lits[0]);
-            continue;
+    struct stat st;
+    if (stat(arg.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR * dir = opendir(arg.c_str());
+        if (! dir) {
+            perror(arg.c_str());
+            exit(1);
         }
-        clause * c;
-        for (uint i = 0; i < lits.size(); ++i) {
-            bool last = true;
-            for (uint j = i + 1; j < lits.size(); ++j) {
-                if (lits[i] == -lits[j]) // tautology found
-                    goto next;
-                if (lits[i] == lits[j]) {
-                    last = false;
-                    break;
-                }
-            }
-            if (last)
-                new_lits.push_back(lits[i]);
+        vector<string> names;
+        while (auto e = readdir(dir)) {
+            size_t len = strlen(e->d_name);
+            if (len > 4 && strcmp(e->d_name + len - 4, ".cnf") == 0)
+                names.push_back(e->d_name);
         }
-        c = make_clause(new_lits, 0, -1);
-        db.push_back(c);
-        watch_clause(c);
-        ++db_num_persistent;
-    next:
-        new_lits.clear();
-    }
-
-    while (! unit.empty()) {
-        int lit = unit.back();
-        unit.pop_back();
-        push(lit, nullptr);
-        if (find_conflict())
-            return false;
-    }
-    if (trail.empty()) {
-        if (! decide())
-            return true;
+        closedir(dir);
+        sort(names.begin(), names.end());
+        for (auto & name : names)
+            enqueue_file(arg + "/" + name);
+        return;
     }
-
-    while (1) {
-        while (auto conflict = find_conflict()) {
-            if (decision_level == 0)
-                return false;
-            analyze(*conflict);
-            ++backoff_timer;
-            if (backoff_timer >= backoff_limit) {
-                backoff_timer = 0;
-                backoff_limit *= 1.5;
-                db_limit = db_num_persistent + (db_limit - db_num_persistent) * 1.1;
-            }
-            decay_activity();
-            ++restart_timer;
+    enqueue_file(arg);
+}
+
+// Solve the problems named by the arguments, or those concatenated on stdin if there are none, printing one record
+// "NAME RESULT SECONDS CONFLICTS" (followed by a model unless -q) per problem in the order they finish.
+int run_batch(int argc, char * argv[]) {
+    vector<thread> workers;
+    for (uint i = 0; i < opt_threads; ++i)
+        workers.emplace_back(batch_worker);
+    if (argc == 0) {
+        open_input(0);
+        for (uint k = 1;; ++k) {
+            job j;
+            j.name = "stdin:" + to_string(k);
+            if (! parse_cnf(j.F))
+                break;
+            enqueue(move(j));
         }
-        simplify();
-        if (restart())
-            continue;
-        if (! decide())
-            return true;
-        reduce();
     }
+    for (int i = 0; i < argc; ++i)
+        enqueue_arg(argv[i]);
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        queue_closed = true;
+    }
+    queue_cv.notify_all();
+    for (auto & t : workers)
+        t.join();
+    return 0;
 }
 
-void check_model() {
-    for (auto & lits : F) {
-        bool found = false;
-        for (int lit : lits) {
-            if (ev(abs(lit)) == lit) {
-                found = true;
-                break;
-            }
-        }
-        if (! found) {
-            fputs("model broken!\n", stderr);
-            exit(2);
-        }
+// Peak resident set size in kB. getrusage would also count the memory of a parent that forked this process.
+long peak_rss() {
+    FILE * fp = fopen("/proc/self/status", "r");
+    if (! fp)
+        return 0;
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmHWM: %ld kB", &kb) == 1)
+            break;
     }
+    fclose(fp);
+    return kb;
+}
+
+double elapsed() {
+    return chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+}
+
+void print_progress(const solver & S) {
+    printf("c %8.2f s %10llu conflicts %8llu restarts %8zu/%zu/%zu clauses %6.2f lbd\n", elapsed(),
+        (unsigned long long) S.num_conflicts, (unsigned long long) S.stats.restarts, S.db[TIER_CORE].size(),
+        S.db[TIER_2].size(), S.db[TIER_LOCAL].size(), S.stats.learnt ? (double) S.stats.learnt_lbd / S.stats.learnt : 0.0);
+    fflush(stdout);
+}
+
+const char * phase_names[NUM_PHASES] = { "propagate", "analyze", "reduce", "simplify", "preprocess", "probe", "vivify",
+    "substitute", "walk", "gauss" };
+
+void print_stats(const solver & S) {
+    auto & st = S.stats;
+    auto ull = [](uint64_t n) { return (unsigned long long) n; };
+    double learnt = max<uint64_t>(st.learnt, 1);
+    printf("c conflicts: %llu, decisions: %llu, propagations: %llu\n", ull(S.num_conflicts), ull(st.decisions),
+        ull(S.num_propagations));
+    printf("c restarts: %llu, blocked: %llu, chronological backtracks: %llu, reductions: %llu, simplifications: %llu\n",
+        ull(st.restarts), ull(st.blocked_restarts), ull(st.chrono_backtracks), ull(st.reductions),
+        ull(st.simplifications));
+    printf("c learnt: %llu, literals per clause: %.2f, lbd per clause: %.2f, deleted: %llu, imported: %llu\n",
+        ull(st.learnt), st.learnt_literals / learnt, st.learnt_lbd / learnt, ull(st.deleted), ull(st.imported));
+    printf("c tiers: core %zu, tier2 %zu, local %zu, promoted: %llu, demoted: %llu\n", S.db[TIER_CORE].size(),
+        S.db[TIER_2].size(), S.db[TIER_LOCAL].size(), ull(st.promoted), ull(st.demoted));
+    printf("c preprocessing: eliminated variables: %llu, subsumed: %llu, strengthened: %llu\n",
+        ull(st.eliminated_vars), ull(st.subsumed), ull(st.strengthened));
+    printf("c inprocessing: rounds: %llu, failed literals: %llu, vivified: %llu (%llu literals), "
+        "substituted: %llu (%llu clauses)\n", ull(st.inprocessings), ull(st.failed_literals), ull(st.vivified),
+        ull(st.vivified_literals), ull(st.substituted), ull(st.substituted_clauses));
+    printf("c local search: walks: %llu, flips: %llu\n", ull(st.walks), ull(st.flips));
+    printf("c xor: detected: %llu, eliminations: %llu, units and equivalences: %llu, rows: %zu\n", ull(st.xors),
+        ull(st.eliminations), ull(st.xor_units), S.xors.size());
+    printf("c time: parse %.3f s", parse_time);
+    for (uint p = 0; p < NUM_PHASES; ++p)
+        printf(", %s %.3f s", phase_names[p], st.time[p]);
+    printf(", total %.3f s\n", elapsed());
+    printf("c peak memory: %ld kB\n", peak_rss());
+}
+
+void write_stats_json(const solver & S, FILE * fp) {
+    auto & st = S.stats;
+    auto ull = [](uint64_t n) { return (unsigned long long) n; };
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"conflicts\": %llu,\n  \"decisions\": %llu,\n  \"propagations\": %llu,\n", ull(S.num_conflicts),
+        ull(st.decisions), ull(S.num_propagations));
+    fprintf(fp, "  \"restarts\": %llu,\n  \"blocked_restarts\": %llu,\n  \"reductions\": %llu,\n", ull(st.restarts),
+        ull(st.blocked_restarts), ull(st.reductions));
+    fprintf(fp, "  \"chrono_backtracks\": %llu,\n  \"simplifications\": %llu,\n", ull(st.chrono_backtracks),
+        ull(st.simplifications));
+    fprintf(fp, "  \"learnt\": %llu,\n  \"learnt_literals\": %llu,\n  \"learnt_lbd\": %llu,\n", ull(st.learnt),
+        ull(st.learnt_literals), ull(st.learnt_lbd));
+    fprintf(fp, "  \"deleted\": %llu,\n  \"imported\": %llu,\n", ull(st.deleted), ull(st.imported));
+    fprintf(fp, "  \"promoted\": %llu,\n  \"demoted\": %llu,\n", ull(st.promoted), ull(st.demoted));
+    fprintf(fp, "  \"eliminated_vars\": %llu,\n  \"subsumed\": %llu,\n  \"strengthened\": %llu,\n",
+        ull(st.eliminated_vars), ull(st.subsumed), ull(st.strengthened));
+    fprintf(fp, "  \"inprocessings\": %llu,\n  \"failed_literals\": %llu,\n", ull(st.inprocessings),
+        ull(st.failed_literals));
+    fprintf(fp, "  \"vivified\": %llu,\n  \"vivified_literals\": %llu,\n", ull(st.vivified), ull(st.vivified_literals));
+    fprintf(fp, "  \"substituted\": %llu,\n  \"substituted_clauses\": %llu,\n", ull(st.substituted),
+        ull(st.substituted_clauses));
+    fprintf(fp, "  \"walks\": %llu,\n  \"flips\": %llu,\n", ull(st.walks), ull(st.flips));
+    fprintf(fp, "  \"xors\": %llu,\n  \"eliminations\": %llu,\n  \"xor_units\": %llu,\n", ull(st.xors),
+        ull(st.eliminations), ull(st.xor_units));
+    fprintf(fp, "  \"time\": { \"parse\": %.6f", parse_time);
+    for (uint p = 0; p < NUM_PHASES; ++p)
+        fprintf(fp, ", \"%s\": %.6f", phase_names[p], st.time[p]);
+    fprintf(fp, ", \"total\": %.6f },\n", elapsed());
+    fprintf(fp, "  \"peak_rss_kb\": %ld\n}\n", peak_rss());
 }
 
 void usage() {
     fputs("Usage: sat [options] [input-file] [output-file]\n", stderr);
+    fputs("       sat -b [options] [input-file | directory | @list-file]...\n", stderr);
     fputs("\n", stderr);
     fputs("Options:\n", stderr);
     fputs("\n", stderr);
     fputs("  -q                Do not print results to stdout\n", stderr);
     fputs("  -C <DRUP_FILE>    Output certificates for unsatisfiable formulas\n", stderr);
+    fputs("  -B                Write the certificate in binary DRAT\n", stderr);
+    fputs("  -T                Write the certificate from a background thread\n", stderr);
+    fputs("  -v                Print statistics as comment lines\n", stderr);
+    fputs("  -S <STATS_FILE>   Write statistics as JSON\n", stderr);
+    fputs("  -j <N>            Run a portfolio of N solvers in parallel (batch mode: N workers)\n", stderr);
+    fputs("  -d <DEPTH>        Cube and conquer: split into cubes of up to DEPTH assumptions\n", stderr);
+    fputs("  -b                Batch mode: solve many problems, printing a record for each\n", stderr);
+    fputs("  -n                Do not simplify the clauses before and during the search\n", stderr);
+    fputs("  -V                Pick decisions by VMTF (move to front) instead of VSIDS\n", stderr);
+    fputs("  -w                Do not rephase by local search during the search\n", stderr);
+    fputs("  -L                Search by local search only; unsatisfiability is never shown. It has no\n", stderr);
+    fputs("                    conflicts, so it cannot be combined with -c; use -t to bound it\n", stderr);
+    fputs("  -X                Do not look for XOR constraints among the clauses\n", stderr);
+    fputs("  -c <CONFLICTS>    Give up on a problem after this many conflicts\n", stderr);
+    fputs("  -t <SECONDS>      Give up on a problem after this much time\n", stderr);
     fputs("  -h                Show this message\n", stderr);
     fputs("\n", stderr);
     exit(1);
@@ -591,22 +728,77 @@ void usage() {
 
 int main(int argc, char * argv[]) {
     int c;
-    while ((c = getopt(argc, argv, "qC:")) != -1) {
+    while ((c = getopt(argc, argv, "qvS:C:BTj:bc:t:d:nVwLX")) != -1) {
         switch (c) {
         case 'q':
             opt_quiet = true;
             break;
+        case 'v':
+            opt_verbose = true;
+            break;
         case 'C':
             opt_cert_file = fopen(optarg, "w");
             if (! opt_cert_file)
                 perror("could not open certificate file");
             break;
+        case 'S':
+            opt_stats_file = fopen(optarg, "w");
+            if (! opt_stats_file)
+                perror("could not open statistics file");
+            break;
+        case 'B':
+            opt_cert_binary = true;
+            break;
+        case 'T':
+            opt_cert_thread = true;
+            break;
+        case 'j':
+            opt_threads = atoi(optarg);
+            if (opt_threads == 0)
+                usage();
+            break;
+        case 'b':
+            opt_batch = true;
+            break;
+        case 'c':
+            opt_conflicts = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            opt_time = atof(optarg);
+            break;
+        case 'd':
+            opt_depth = atoi(optarg);
+            break;
+        case 'n':
+            opt_preprocess = false;
+            break;
+        case 'V':
+            opt_vmtf = true;
+            break;
+        case 'w':
+            opt_rephase = false;
+            break;
+        case 'L':
+            opt_walk_only = true;
+            break;
+        case 'X':
+            opt_xor = false;
+            break;
         default:
             usage();
         }
     }
     argc -= optind;
     argv += optind;
+    if (opt_walk_only && opt_conflicts > 0) // local search would run on, past any conflict budget
+        usage();
+    if (opt_cert_file)
+        proof = make_unique<proof_writer>(opt_cert_file, opt_cert_binary, opt_cert_thread);
+    if (opt_batch) {
+        if (opt_cert_file || opt_depth > 0)
+            usage();
+        return run_batch(argc, argv);
+    }
     if (argc > 2)
         usage();
     if (argc > 0) {
@@ -625,38 +817,64 @@ int main(int argc, char * argv[]) {
     }
 
     // read cnf
-    while (getchar() == 'c') {
-        while (getchar() != '\n')
-            ;
-    }
-    scanf(" cnf %d %d", &N, &M);
-    F.resize(M);
-    for (auto & c : F) {
-        int lit;
-        while (scanf("%d", &lit), lit != 0) {
-            c.push_back(lit);
-        }
+    auto parse_start = chrono::steady_clock::now();
+    cnf F;
+    open_input(0);
+    if (! parse_cnf(F))
+        parse_error("'p cnf' expected");
+    parse_time = chrono::duration<double>(chrono::steady_clock::now() - parse_start).count();
+    if (opt_verbose) {
+        printf("c parse time: %.3f s\n", parse_time);
+        printf("c variables: %u, clauses: %u, literals: %zu, cardinality constraints: %u, xor constraints: %u\n",
+            F.num_vars, F.size(), F.lits.size(), F.num_cards(), F.num_xors());
+    }
+    if (proof && F.num_cards() + F.num_xors() > 0) {
+        fputs("cardinality and XOR constraints cannot be certified by a DRAT proof\n", stderr);
+        exit(1);
+    }
+
+    vector<solver> solvers(opt_threads);
+    if (opt_verbose)
+        solvers[0].progress = print_progress;
+    uint winner = 0;
+    result res;
+    if (opt_depth > 0) {
+        res = solve_cubes(F, solvers, winner);
+    } else if (opt_threads == 1) {
+        configure(solvers[0]);
+        solvers[0].proof = proof.get();
+        load(solvers[0], F);
+        res = solvers[0].solve();
+    } else {
+        res = solve_portfolio(F, solvers, winner);
+        if (opt_verbose)
+            printf("c portfolio: solver %u finished first\n", winner);
+    }
+    const solver & S = solvers[winner];
+    if (opt_verbose)
+        print_stats(S);
+    if (opt_stats_file) {
+        write_stats_json(S, opt_stats_file);
+        fclose(opt_stats_file);
     }
-
-    bool sat = solve();
 
     // follow sat competition's output format
-    if (! sat) {
-        if (opt_cert_file)
-            fputs("0\n", opt_cert_file);
+    if (res == UNSATISFIABLE) {
+        if (proof)
+            proof->add(nullptr, 0);
         if (! opt_quiet)
             puts("s UNSATISFIABLE");
         return 20;
     }
-    check_model();
+    if (res == UNKNOWN) {
+        if (! opt_quiet)
+            puts("s UNKNOWN");
+        return 0;
+    }
+    check_model(F, S);
     if (! opt_quiet) {
         puts("s SATISFIABLE");
-        printf("v ");
-        for (uint v = 1; v <= N; ++v) {
-            if (defined(v))
-                printf("%d ", ev(v));
-        }
-        puts("0");
+        print_model(F, S);
     }
     return 10;
 }
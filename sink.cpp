@@ -0,0 +1,125 @@
+#include "sink.h"
+#include <cstdlib>
+extern "C" {
+#include <fcntl.h>
+}
+
+using namespace std;
+
+void clause_sink::add_at_most(const int * lits, uint num_lit, uint bound) {
+    vector<uint> pick; // indices of the literals in the clause, increasing
+    vector<int> clause;
+    for (uint i = 0; i <= bound && i < num_lit; ++i)
+        pick.push_back(i);
+    while (pick.size() == bound + 1) {
+        clause.clear();
+        for (uint i : pick)
+            clause.push_back(-lits[i]);
+        add(clause);
+        uint k = bound + 1; // advance to the next combination
+        while (k > 0 && pick[k - 1] == num_lit - (bound + 1 - (k - 1)))
+            --k;
+        if (k == 0)
+            break;
+        ++pick[k - 1];
+        for (uint i = k; i <= bound; ++i)
+            pick[i] = pick[i - 1] + 1;
+    }
+}
+
+cnf_writer::cnf_writer(FILE * out, bool binary) : out(out), binary(binary), body(out) {
+    buf.reserve(WRITER_BUFFER_SIZE + 4096);
+    header_pos = ftell(out);
+    bool append = (fcntl(fileno(out), F_GETFL) & O_APPEND) != 0; // writes would all go to the end
+    if (header_pos >= 0 && ! append && fseek(out, header_pos, SEEK_SET) == 0) {
+        buf.assign(HEADER_WIDTH - 1, ' ');
+        buf.push_back('\n');
+    } else {
+        header_pos = -1;
+        if (! (body = tmpfile())) {
+            perror("cannot create a temporary file");
+            exit(1);
+        }
+    }
+}
+
+// The literals, followed by the 0 of a clause in binary, or by a space in text.
+void cnf_writer::write_lits(const int * lits, uint num_lit) {
+    if (binary) {
+        for (uint i = 0; i < num_lit; ++i) {
+            uint u = 2 * abs(lits[i]) + (lits[i] < 0);
+            while (u > 127) {
+                buf.push_back(0x80 | (u & 127));
+                u >>= 7;
+            }
+            buf.push_back(u);
+        }
+        buf.push_back(0);
+        return;
+    }
+    for (uint i = 0; i < num_lit; ++i) {
+        int lit = lits[i];
+        char tmp[12];
+        char * p = tmp + sizeof(tmp);
+        uint u = abs(lit);
+        do {
+            *--p = '0' + u % 10;
+            u /= 10;
+        } while (u != 0);
+        if (lit < 0)
+            *--p = '-';
+        buf.insert(buf.end(), p, tmp + sizeof(tmp));
+        buf.push_back(' ');
+    }
+}
+
+void cnf_writer::add(const int * lits, uint num_lit) {
+    write_lits(lits, num_lit);
+    if (! binary) {
+        buf.push_back('0');
+        buf.push_back('\n');
+    }
+    ++num_clauses;
+    if (buf.size() >= WRITER_BUFFER_SIZE)
+        flush();
+}
+
+void cnf_writer::add_at_most(const int * lits, uint num_lit, uint bound) {
+    if (binary) {
+        clause_sink::add_at_most(lits, num_lit, bound);
+        return;
+    }
+    write_lits(lits, num_lit);
+    char tmp[16];
+    int n = snprintf(tmp, sizeof(tmp), "<= %u\n", bound);
+    buf.insert(buf.end(), tmp, tmp + n);
+    ++num_clauses;
+    if (buf.size() >= WRITER_BUFFER_SIZE)
+        flush();
+}
+
+void cnf_writer::flush() {
+    fwrite(buf.data(), 1, buf.size(), body);
+    buf.clear();
+}
+
+void cnf_writer::finish(uint num_vars) {
+    flush();
+    char header[64];
+    int n = snprintf(header, sizeof(header), "p %s %u %llu", binary ? "bcnf" : "cnf", num_vars,
+        (unsigned long long) num_clauses);
+    if (header_pos >= 0) {
+        fseek(out, header_pos, SEEK_SET);
+        fwrite(header, 1, n, out); // the spaces after it remain
+        fseek(out, 0, SEEK_END);
+    } else {
+        fprintf(out, "%s\n", header);
+        rewind(body);
+        buf.resize(WRITER_BUFFER_SIZE);
+        while (size_t k = fread(buf.data(), 1, buf.size(), body))
+            fwrite(buf.data(), 1, k, out);
+        buf.clear();
+        fclose(body);
+    }
+    fflush(out);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "solver.h"
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#define WRITER_BUFFER_SIZE (1 << 20) // bytes collected before they go to the file
+#define HEADER_WIDTH 40 // room kept for the header, which is only known at the end
+
+// Where an encoder sends its clauses: straight into a solver, or out as a CNF file.
+struct clause_sink {
+    virtual ~clause_sink() = default;
+    virtual void add(const int * lits, uint num_lit) = 0;
+    // At most `bound` of the literals are true. Sinks without native support get a clause for every bound + 1 of
+    // them, which is only reasonable for small bounds.
+    virtual void add_at_most(const int * lits, uint num_lit, uint bound);
+    virtual void finish(uint num_vars) { // no more clauses; num_vars is the largest variable
+        (void) num_vars;
+    }
+    void add(std::initializer_list<int> lits) {
+        add(lits.begin(), lits.size());
+    }
+    void add(const std::vector<int> & lits) {
+        add(lits.data(), lits.size());
+    }
+    void add_at_most(const std::vector<int> & lits, uint bound) {
+        add_at_most(lits.data(), lits.size(), bound);
+    }
+};
+
+// Clauses go into the solver's arena as they come; there is no text in between.
+struct solver_sink : clause_sink {
+    solver & S;
+    solver_sink(solver & S) : S(S) {
+    }
+    void add(const int * lits, uint num_lit) override {
+        S.add_clause(lits, num_lit);
+    }
+    void add_at_most(const int * lits, uint num_lit, uint bound) override {
+        S.add_at_most(lits, num_lit, bound);
+    }
+    using clause_sink::add;
+    using clause_sink::add_at_most;
+};
+
+// DIMACS output, either as text or in the binary format read by sat: a text header "p bcnf VARS CLAUSES", then each
+// clause as the literals of binary DRAT (2 * var + sign in 7-bit groups, low first, the high bit set on all but the
+// last) followed by a 0 byte. Text takes cardinality constraints natively, as "LITS <= BOUND" lines. The header
+// must come first but its counts are only known at `finish`, so it is written into room kept at the start of the
+// output if that can be sought; otherwise the clauses are held in a temporary file until then.
+struct cnf_writer : clause_sink {
+    FILE * out;
+    bool binary;
+    FILE * body; // the temporary file, or `out`
+    long header_pos = -1; // where the header goes in `out`; -1 if it cannot be sought
+    std::vector<char> buf;
+    uint64_t num_clauses = 0; // and cardinality constraints
+
+    cnf_writer(FILE * out, bool binary);
+    void add(const int * lits, uint num_lit) override;
+    void add_at_most(const int * lits, uint num_lit, uint bound) override;
+    using clause_sink::add;
+    using clause_sink::add_at_most;
+    void finish(uint num_vars) override;
+    void write_lits(const int * lits, uint num_lit);
+    void flush();
+};
@@ -0,0 +1,1123 @@
+#include "solver.h"
+#include "exchange.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+#define CLAUSE_DECAY_FACTOR (0.999)
+#define CLAUSE_RESCALE_LIMIT (1e20)
+#define CORE_MAX_LBD 2 // learnt clauses of at most this LBD are never deleted
+#define TIER2_MAX_LBD 6
+#define REDUCE_INTERVAL 2000 // conflicts before the first `reduce`; the interval grows by REDUCE_INCREMENT each time
+#define REDUCE_INCREMENT 300
+#define RESTART_MIN_CONFLICTS 50
+#define RESTART_MARGIN 1.25 // restart when recent learnt clauses have this much larger LBD than the average
+#define MODE_INTERVAL 2000 // conflicts of the first focused phase; the phases grow longer each round
+#define BLOCK_MIN_CONFLICTS 20000 // restarts are never blocked before this many conflicts
+#define BLOCK_MARGIN 1.6 // block a restart when this many more variables than usual are assigned
+#define SHARE_MAX_LBD 4 // learnt clauses with at most this LBD (or at most two literals) are exported
+#define CHRONO_MIN_JUMP 100 // a conflict that would undo more levels than this only undoes one
+#define LOOKAHEAD_CANDIDATES 16 // most active variables tried by `lookahead`
+
+uint clause_words(uint num_lit) {
+    return (sizeof(clause) + sizeof(int) * num_lit) / sizeof(uint);
+}
+
+bool is_clause(reason_ref r) {
+    return r < CARD_REASON;
+}
+bool is_card(reason_ref r) {
+    return (r & (BINARY_REASON | XOR_REASON)) == CARD_REASON;
+}
+bool is_xor(reason_ref r) {
+    return (r & (BINARY_REASON | XOR_REASON)) == XOR_REASON;
+}
+reason_ref binary_reason(int lit) {
+    return BINARY_REASON | abs(lit) << 1 | (lit < 0);
+}
+int binary_reason_lit(reason_ref r) {
+    int v = (r & ~BINARY_REASON) >> 1;
+    return (r & 1) != 0 ? -v : v;
+}
+// literals of reason `r` other than the one it implies; `tmp` provides storage for a binary reason
+pair<const int *, const int *> solver::antecedents(reason_ref r, int & tmp) {
+    if (is_card(r)) {
+        auto & reason = cards[r & ~CARD_REASON].reason;
+        return { reason.data(), reason.data() + reason.size() };
+    }
+    if (is_xor(r)) { // the other variables as they are now, which they were when it implied
+        auto & x = xors[r & ~XOR_REASON];
+        xor_reason.clear();
+        for (uint v : x.vars) {
+            if (v != x.implied)
+                xor_reason.push_back(phase(v) ? -(int) v : v);
+        }
+        return { xor_reason.data(), xor_reason.data() + xor_reason.size() };
+    }
+    if (! is_clause(r)) {
+        tmp = binary_reason_lit(r);
+        return { &tmp, &tmp + 1 };
+    }
+    auto c = deref(r);
+    return { c->lits + 1, c->lits + c->num_lit };
+}
+// Whether clause r is the reason of an assignment. A reason implies its first literal, so only that variable needs to
+// be looked at; the clause itself is not written to when it becomes or stops being a reason.
+bool solver::locked(clause_ref r) {
+    int lit = deref(r)->lits[0];
+    return ev(abs(lit)) == lit && vars[abs(lit)].reason == r;
+}
+
+void solver::push(int lit, reason_ref r, uint lv) {
+    uint var = abs(lit);
+    model[var] = lit > 0 ? MODEL_DEFINED | MODEL_PHASE : MODEL_DEFINED;
+    vars[var].level = lv;
+    vars[var].reason = r;
+    trail.push_back(lit);
+    for (uint index : card_list(lit))
+        ++cards[index].num_true;
+    // var is lazily removed from the decision queue
+}
+
+// Clause references share `reason_ref` with the tagged reasons from CARD_REASON up, so a clause must end below it;
+// past that its offset would be read as a cardinality or XOR reason.
+void check_arena(size_t end) {
+    if (end > CARD_REASON) {
+        fputs("clause arena exceeds 2^30 words\n", stderr);
+        abort();
+    }
+}
+
+clause_ref solver::make_clause(const vector<int> & lits, int flags, uint score) {
+    clause_ref r = arena.size();
+    check_arena((size_t) r + clause_words(lits.size()));
+    arena.resize(r + clause_words(lits.size()));
+    clause * c = deref(r);
+    c->num_lit = lits.size();
+    for (uint i = 0; i < lits.size(); ++i)
+        c->lits[i] = lits[i];
+    c->flags = flags;
+    c->score = min(score, MAX_SCORE);
+    c->activity = 0;
+    return r;
+}
+void solver::free_clause(clause_ref r) {
+    clause * c = deref(r);
+    c->flags |= CLAUSE_DELETED;
+    arena_wasted += clause_words(c->num_lit);
+}
+
+void solver::add_binary(int a, int b) {
+    bin_list(a).push_back(b);
+    bin_list(b).push_back(a);
+}
+void solver::watch_clause(clause_ref r) {
+    clause * c = deref(r);
+    for (auto i : { 0, 1 }) {
+        watch_list(c->lits[i]).push_back({ r, c->lits[1 - i] });
+    }
+}
+// Drop the watchers of deleted clauses, all in one pass rather than two list scans per clause.
+void solver::sweep_watches() {
+    for (auto lists : { &pos_list, &neg_list }) {
+        for (auto & wlist : *lists) {
+            uint j = 0;
+            for (auto w : wlist) {
+                if ((deref(w.cref)->flags & CLAUSE_DELETED) == 0)
+                    wlist[j++] = w;
+            }
+            wlist.resize(j);
+        }
+    }
+}
+
+void solver::decay_activity() {
+    if (! vmtf)
+        activity_increment *= (1 / activity_decay);
+    clause_increment *= (1 / CLAUSE_DECAY_FACTOR);
+}
+
+uint lbd_tier(uint lbd) {
+    return lbd <= CORE_MAX_LBD ? TIER_CORE : lbd <= TIER2_MAX_LBD ? TIER_2 : TIER_LOCAL;
+}
+uint clause_tier(const clause * c) {
+    return (c->flags & CLAUSE_TIER) >> CLAUSE_TIER_SHIFT;
+}
+void set_tier(clause * c, uint tier) {
+    c->flags = (c->flags & ~CLAUSE_TIER) | tier << CLAUSE_TIER_SHIFT;
+}
+
+void solver::bump_clause(clause * c) {
+    if ((c->flags & CLAUSE_LEARNT) == 0)
+        return;
+    c->flags |= CLAUSE_USED;
+    if ((c->activity += clause_increment) > CLAUSE_RESCALE_LIMIT) {
+        clause_increment *= (1 / CLAUSE_RESCALE_LIMIT);
+        for (uint t = TIER_2; t < NUM_TIERS; ++t) {
+            for (auto r : db[t])
+                deref(r)->activity *= (1 / CLAUSE_RESCALE_LIMIT);
+        }
+    }
+}
+
+void solver::note_lbd(uint lbd) {
+    STAT(stats.learnt_lbd += lbd);
+    lbd_fast.update(lbd);
+    lbd_slow.update(lbd);
+}
+
+// Undo the levels above lv: unassign their variables from the top of the trail down, then compact the trail. Literals
+// of lower levels found there, which were implied out of order after chronological backtracking, stay assigned; they
+// move down and are propagated again.
+void solver::backjump(uint lv) {
+    if (decision_level <= lv)
+        return;
+    uint start = trail_lim[lv], keep = start;
+    for (uint i = trail.size(); i-- > start;) {
+        uint var = abs(trail[i]);
+        if (vars[var].level <= lv)
+            continue;
+        model[var] &= ~MODEL_DEFINED;
+        for (uint index : card_list(trail[i]))
+            --cards[index].num_true;
+        if (vmtf) {
+            if (queue_stamp[var] > queue_stamp[queue_search])
+                queue_search = var;
+        } else if (heap_index[var] == 0) {
+            heap_push(var);
+        }
+    }
+    for (uint i = start; i < trail.size(); ++i) {
+        if (defined(abs(trail[i])))
+            trail[keep++] = trail[i];
+    }
+    trail.resize(keep);
+    trail_lim.resize(lv);
+    decision_level = lv;
+    propagated = min(propagated, start);
+}
+
+// Number of distinct decision levels among the literals. A level is counted when its stamp is not the current one,
+// so nothing needs to be cleared afterwards.
+uint solver::compute_lbd(const int * lits, uint num_lit) {
+    if (++lbd_stamp == 0) { // wrapped around
+        fill(level_stamp.begin(), level_stamp.end(), 0);
+        lbd_stamp = 1;
+    }
+    uint lbd = 0;
+    for (uint i = 0; i < num_lit; ++i) {
+        auto lv = vars[abs(lits[i])].level;
+        if (level_stamp[lv] != lbd_stamp) {
+            level_stamp[lv] = lbd_stamp;
+            ++lbd;
+        }
+    }
+    return lbd;
+}
+
+// Lower the LBD of a learnt clause used in `analyze` if it has become smaller. Clauses already in the core tier
+// cannot improve in a way that matters.
+void solver::update_lbd(clause * c) {
+    if ((c->flags & CLAUSE_LEARNT) == 0 || c->score <= CORE_MAX_LBD)
+        return;
+    uint lbd = compute_lbd(c->lits, c->num_lit);
+    if (lbd >= c->score)
+        return;
+    if (lbd_tier(lbd) < clause_tier(c)) {
+        set_tier(c, lbd_tier(lbd)); // moved to its new tier by the next `reduce`
+        STAT(++stats.promoted);
+    }
+    c->score = lbd;
+}
+
+// The literals of a conflict, all false.
+pair<int *, uint> solver::conflict_lits(reason_ref confl) {
+    if (is_clause(confl))
+        return { deref(confl)->lits, deref(confl)->num_lit };
+    if (is_card(confl) || is_xor(confl))
+        return { constraint_conflict.data(), constraint_conflict.size() };
+    return { binary_conflict, 2 };
+}
+
+// The highest level among the literals of a conflict, which is where `analyze` resolves it; after chronological
+// backtracking it can be below the current level. The two literals of the highest levels are moved to the front, so
+// that a clause, or an XOR row, stays watched by unassigned literals when `analyze` backtracks.
+uint solver::conflict_level(reason_ref confl) {
+    auto [lits, num_lit] = conflict_lits(confl);
+    for (uint w = 0; w < 2; ++w) {
+        uint best = w;
+        for (uint k = w + 1; k < num_lit; ++k) {
+            if (vars[abs(lits[k])].level > vars[abs(lits[best])].level)
+                best = k;
+        }
+        if (best >= 2 && is_clause(confl)) { // not watched; it takes over the watcher of lits[w]
+            auto & wlist = watch_list(lits[w]);
+            auto p = find_if(wlist.begin(), wlist.end(), [&](auto & w) { return w.cref == confl; });
+            watch_list(lits[best]).push_back(*p);
+            *p = wlist.back();
+            wlist.pop_back();
+        }
+        swap(lits[w], lits[best]);
+    }
+    if (is_xor(confl)) {
+        uint index = confl & ~XOR_REASON;
+        auto & x = xors[index];
+        for (uint w = 0; w < 2; ++w) {
+            uint v = abs(lits[w]);
+            auto p = find(x.vars.begin(), x.vars.end(), v);
+            if (p - x.vars.begin() >= 2) {
+                auto & wlist = xor_watch[x.vars[w]];
+                *find(wlist.begin(), wlist.end(), index) = wlist.back();
+                wlist.pop_back();
+                xor_watch[v].push_back(index);
+            }
+            swap(x.vars[w], *p);
+        }
+    }
+    return vars[abs(lits[0])].level;
+}
+
+// Learn a clause from the conflict, which `conflict_level` has prepared, and backtrack to where it asserts its UIP:
+// the second highest level in the clause or, if that would undo more than CHRONO_MIN_JUMP levels, just below the
+// conflict.
+void solver::analyze(reason_ref confl) {
+    TIME_PHASE(PHASE_ANALYZE);
+    auto [conflict, conflict_size] = conflict_lits(confl);
+    uint conflict_lv = vars[abs(conflict[0])].level;
+    if (vars[abs(conflict[1])].level < conflict_lv) { // one literal at that level; the clause implies it a level lower
+        backjump(conflict_lv - 1);
+        reason_ref r = is_clause(confl) || is_xor(confl) ? confl : binary_reason(conflict[1]);
+        if (is_xor(confl))
+            xors[confl & ~XOR_REASON].implied = abs(conflict[0]);
+        // A violated cardinality constraint becomes a clause first: as a reason it would name all of its true
+        // literals, some of which may have been assigned after literals it implied earlier.
+        if (is_card(confl) && conflict_size > 2) {
+            learnt.assign(conflict, conflict + conflict_size);
+            r = make_clause(learnt, CLAUSE_LEARNT, compute_lbd(learnt.data(), conflict_size));
+            learnt.clear();
+            set_tier(deref(r), lbd_tier(deref(r)->score));
+            db[lbd_tier(deref(r)->score)].push_back(r);
+            watch_clause(r);
+        } else if (is_card(confl)) {
+            add_binary(conflict[0], conflict[1]);
+        }
+        push(conflict[0], r, vars[abs(conflict[1])].level);
+        return;
+    }
+    backjump(conflict_lv);
+    if (is_clause(confl)) {
+        bump_clause(deref(confl));
+        update_lbd(deref(confl));
+    }
+    learnt.push_back(0); // reserve learnt[0] for UIP
+    uint count = 0;
+    int tmp;
+    for (uint i = 0; i < conflict_size; ++i) {
+        int lit = conflict[i];
+        uint v = abs(lit);
+        uint lv = vars[v].level;
+        if (lv == 0)
+            continue;
+        seen[v] = true;
+        if (lv < decision_level) {
+            learnt.push_back(lit);
+        } else {
+            ++count;
+        }
+        bumped.push_back(v);
+    }
+    int uip;
+    for (uint i = trail.size() - 1; true; --i) {
+        int lit = trail[i];
+        uint v = abs(lit);
+        if (! seen[v] || vars[v].level < decision_level) // the latter may come late on the trail
+            continue;
+        seen[v] = false;
+        --count;
+        if (count == 0) {
+            uip = lit;
+            break;
+        }
+        if (is_clause(vars[v].reason)) {
+            bump_clause(deref(vars[v].reason));
+            update_lbd(deref(vars[v].reason));
+        }
+        auto [begin, end] = antecedents(vars[v].reason, tmp);
+        for (auto p = begin; p != end; ++p) {
+            int lit = *p;
+            uint v = abs(lit);
+            if (seen[v])
+                continue;
+            uint lv = vars[v].level;
+            if (lv == 0)
+                continue;
+            seen[v] = true;
+            if (lv < decision_level) {
+                learnt.push_back(lit);
+            } else {
+                ++count;
+            }
+            bumped.push_back(v);
+        }
+    }
+    learnt[0] = -uip;
+    // minimize clause
+    for (uint i = 1; i < learnt.size(); ++i) {
+        bool subsume = true;
+        uint v = abs(learnt[i]);
+        stack.push_back({ v, true });
+        while (! stack.empty()) {
+            auto [v, cont] = stack.back();
+            stack.pop_back();
+            if (! cont) {
+                if (! seen[v]) {
+                    seen[v] = true; // v is removable
+                    trash.push_back(v);
+                }
+                continue;
+            }
+            auto r = vars[v].reason;
+            if (r == NO_CLAUSE) {
+                subsume = false;
+                break;
+            }
+            stack.push_back({ v, false });
+            auto [begin, end] = antecedents(r, tmp);
+            for (auto p = begin; p != end; ++p) {
+                uint v = abs(*p);
+                if (! (seen[v] || vars[v].level == 0))
+                    stack.push_back({ v, true });
+            }
+        }
+        if (subsume) {
+            seen[v] = false;
+            learnt[i] = learnt.back();
+            learnt.pop_back();
+            --i;
+        }
+        stack.clear();
+    }
+    for (uint v : trash) {
+        seen[v] = false;
+    }
+    trash.clear();
+    uint num_lit = learnt.size();
+    for (uint i = 1; i < num_lit; ++i)
+        seen[abs(learnt[i])] = false;
+    if (proof)
+        proof->add(learnt.data(), num_lit);
+    STAT(++stats.learnt);
+    STAT(stats.learnt_literals += num_lit);
+    uint max_lv = 0;
+    for (uint i = 1; i < num_lit; ++i) {
+        uint lv = vars[abs(learnt[i])].level;
+        if (lv > max_lv) {
+            max_lv = lv;
+            swap(learnt[1], learnt[i]);
+        }
+    }
+    if (decision_level - max_lv > CHRONO_MIN_JUMP) {
+        backjump(decision_level - 1);
+        STAT(++stats.chrono_backtracks);
+    } else {
+        backjump(max_lv);
+    }
+    if (exchange && num_lit <= 2)
+        exchange->push(exchange_id, learnt.data(), num_lit, num_lit);
+    if (num_lit == 1) {
+        note_lbd(1);
+        push(-uip, NO_CLAUSE, 0);
+        learnt.clear();
+        return;
+    }
+    if (num_lit == 2) { // binary clauses never enter the arena
+        note_lbd(2);
+        add_binary(learnt[0], learnt[1]);
+        push(-uip, binary_reason(learnt[1]), max_lv);
+        learnt.clear();
+        return;
+    }
+    // learn new clause
+    auto r = make_clause(learnt, CLAUSE_LEARNT, compute_lbd(learnt.data(), num_lit));
+    auto c = deref(r);
+    note_lbd(c->score);
+    bump_clause(c);
+    if (exchange && c->score <= SHARE_MAX_LBD)
+        exchange->push(exchange_id, c->lits, num_lit, c->score);
+    push(-uip, r, max_lv);
+    learnt.clear();
+    set_tier(c, lbd_tier(c->score));
+    db[lbd_tier(c->score)].push_back(r);
+    watch_clause(r);
+}
+
+// The level of the literal that clause c implies: the highest level of its other literals.
+uint solver::reason_level(const clause * c) {
+    uint lv = 0;
+    for (uint i = 1; i < c->num_lit; ++i)
+        lv = max(lv, vars[abs(c->lits[i])].level);
+    return lv;
+}
+
+optional<reason_ref> solver::find_conflict() {
+    TIME_PHASE(PHASE_PROPAGATE);
+    uint prop = propagated; // a local copy, which stores into the trail cannot alias
+    for (; prop < trail.size(); ++prop) {
+        int lit = trail[prop];
+        uint lv = vars[abs(lit)].level; // below the current level if lit was implied out of order
+        ++num_propagations;
+        for (int other : bin_list(-lit)) {
+            if (ev(abs(other)) == other)
+                continue;
+            if (defined(abs(other))) {
+                binary_conflict[0] = -lit;
+                binary_conflict[1] = other;
+                propagated = prop;
+                return binary_reason(other);
+            }
+            push(other, binary_reason(-lit), lv);
+        }
+        for (uint index : card_list(lit)) {
+            if (! propagate_card(index)) {
+                propagated = prop;
+                return CARD_REASON | index;
+            }
+        }
+        if (auto confl = propagate_xors(abs(lit))) {
+            propagated = prop;
+            return confl;
+        }
+        auto & wlist = watch_list(-lit);
+        auto i = wlist.begin(), j = i, end = wlist.end(); // read and write cursors
+        while (i != end) {
+            auto w = *i++;
+            if (ev(abs(w.blocker)) == w.blocker) { // satisfied; clause is not touched
+                *j++ = w;
+                continue;
+            }
+            auto c = deref(w.cref);
+            if (c->lits[0] == -lit)
+                swap(c->lits[0], c->lits[1]);
+            int lit = c->lits[0];
+            w.blocker = lit;
+            if (ev(abs(lit)) == lit) { // satisfied
+                *j++ = w;
+                continue;
+            }
+            for (uint k = 2; k < c->num_lit; ++k) {
+                int lit = c->lits[k];
+                if (ev(abs(lit)) != -lit) { // update watch list
+                    watch_list(lit).push_back(w);
+                    swap(c->lits[1], c->lits[k]);
+                    goto next;
+                }
+            }
+            *j++ = w;
+            if (defined(abs(lit))) { // conflict found
+                while (i != end)
+                    *j++ = *i++;
+                wlist.erase(j, end);
+                propagated = prop;
+                return w.cref;
+            }
+            push(lit, w.cref, lv == decision_level ? lv : reason_level(c));
+        next:;
+        }
+        wlist.erase(j, end);
+    }
+    propagated = prop;
+    return nullopt; // no conflict found
+}
+
+void solver::new_level(int lit) {
+    trail_lim.push_back(trail.size());
+    ++decision_level;
+    if (decision_level >= decision.size()) { // more levels than variables due to assumptions
+        decision.resize(decision_level + 1);
+        level_stamp.resize(decision_level + 1);
+    }
+    decision[decision_level] = abs(lit);
+    if (! defined(abs(lit))) // an assumption may already hold; its level is then empty
+        push(lit, NO_CLAUSE, decision_level);
+}
+
+bool solver::decide() {
+    int lit;
+    if ((lit = choose()) == 0)
+        return false; // sat
+    STAT(++stats.decisions);
+    new_level(lit);
+    return true;
+}
+
+// Move live clauses to a fresh arena in `db` order and redirect watches and reasons to the new locations.
+void solver::collect_garbage() {
+    if (arena_wasted < arena.size() / 4)
+        return;
+    vector<uint> to;
+    to.reserve(arena.size() - arena_wasted);
+    for (auto & tier : db) {
+        for (auto & r : tier) {
+            clause * c = deref(r);
+            clause_ref new_r = to.size();
+            check_arena(to.size() + clause_words(c->num_lit));
+            to.insert(to.end(), arena.begin() + r, arena.begin() + r + clause_words(c->num_lit));
+            c->flags |= CLAUSE_RELOCATED;
+            c->num_lit = new_r; // forwarding address
+            r = new_r;
+        }
+    }
+    for (auto lists : { &pos_list, &neg_list }) {
+        for (auto & wlist : *lists) {
+            for (auto & w : wlist)
+                w.cref = deref(w.cref)->num_lit; // watched clauses are always live
+        }
+    }
+    for (uint v = 1; v <= N; ++v) {
+        auto & r = vars[v].reason;
+        if (! is_clause(r))
+            continue;
+        if (! defined(v)) {
+            r = NO_CLAUSE;
+            continue;
+        }
+        auto c = deref(r);
+        r = (c->flags & CLAUSE_RELOCATED) != 0 ? c->num_lit : NO_CLAUSE; // level 0 reasons may be gone after `simplify`
+    }
+    arena.swap(to);
+    arena_wasted = 0;
+}
+
+// Move learnt clauses between tiers: promoted ones to their new tier, and tier-2 clauses that took part in no conflict
+// since the last time to the local tier. Then delete the less active half of the local tier.
+void solver::reduce() {
+    if (num_conflicts < next_reduce)
+        return;
+    TIME_PHASE(PHASE_REDUCE);
+    STAT(++stats.reductions);
+    reduce_interval += REDUCE_INCREMENT;
+    next_reduce = num_conflicts + reduce_interval;
+    for (uint t = TIER_2; t < NUM_TIERS; ++t) {
+        uint new_size = 0;
+        for (uint i = 0; i < db[t].size(); ++i) {
+            auto r = db[t][i];
+            auto c = deref(r);
+            if (t == TIER_2 && clause_tier(c) == TIER_2 && (c->flags & CLAUSE_USED) == 0) {
+                set_tier(c, TIER_LOCAL);
+                STAT(++stats.demoted);
+            }
+            c->flags &= ~CLAUSE_USED;
+            if (clause_tier(c) == t)
+                db[t][new_size++] = r;
+            else
+                db[clause_tier(c)].push_back(r);
+        }
+        db[t].resize(new_size);
+    }
+    auto & local = db[TIER_LOCAL];
+    uint new_size = local.size() / 2;
+    nth_element(local.begin(), local.begin() + new_size, local.end(), [&](auto x, auto y) {
+        return deref(x)->activity > deref(y)->activity;
+    });
+    for (uint i = new_size; i < local.size(); ++i) {
+        auto c = deref(local[i]);
+        if (locked(local[i])) {
+            local[new_size++] = local[i];
+            continue;
+        }
+        if (proof && cert_deletions)
+            proof->remove(c->lits, c->num_lit);
+        free_clause(local[i]);
+        STAT(++stats.deleted);
+    }
+    local.resize(new_size);
+    sweep_watches();
+    collect_garbage();
+}
+
+// The search alternates between focused phases, where it restarts as in Glucose when the recent learnt clauses are
+// worse than usual, and stable phases of Luby restarts, which do better on some satisfiable problems.
+bool solver::restart_due() {
+    if (! luby_restarts && num_conflicts >= next_mode_switch) {
+        stable = ! stable;
+        if (! stable)
+            mode_interval *= 2;
+        next_mode_switch = num_conflicts + mode_interval;
+    }
+    if (luby_restarts || stable) {
+        if (restart_timer < restart_limit)
+            return false;
+        luby_seq = {
+            (luby_seq[0] & -luby_seq[0]) == luby_seq[1] ? luby_seq[0] + 1 : luby_seq[0],
+            (luby_seq[0] & -luby_seq[0]) == luby_seq[1] ? 1 : 2 * luby_seq[1]
+        };
+        restart_limit = restart_base * luby_seq[1];
+    } else if (restart_timer < RESTART_MIN_CONFLICTS || lbd_fast.value <= RESTART_MARGIN * lbd_slow.value) {
+        return false;
+    }
+    restart_timer = 0;
+    return true;
+}
+
+// Backjump to the lowest level whose decision is less active than the next one, reusing the trail below it.
+bool solver::restart() {
+    uint next_var = next_decision();
+    if (next_var == 0)
+        return false;
+    auto next_priority = priority(next_var);
+    for (uint level = assumptions.size(); level < decision_level; ++level) {
+        uint var = decision[level + 1];
+        if (priority(var) < next_priority) {
+            backjump(level);
+            STAT(++stats.restarts);
+            return true;
+        }
+    }
+    return false;
+}
+
+void solver::simplify() {
+    if (decision_level > 0 || trail.size() == simplified_trail) // nothing new since last time
+        return;
+    simplified_trail = trail.size();
+    TIME_PHASE(PHASE_SIMPLIFY);
+    STAT(++stats.simplifications);
+    for (auto & tier : db) {
+        uint new_size = 0;
+        for (uint i = 0; i < tier.size(); ++i) {
+            auto r = tier[i];
+            auto c = deref(r);
+            bool satisfied = false;
+            for (uint i = 0; i < c->num_lit; ++i) {
+                int lit = c->lits[i];
+                if (ev(abs(lit)) == lit) {
+                    satisfied = true;
+                    break;
+                }
+            }
+            if (satisfied) {
+                if (proof && cert_deletions && ! locked(r)) // checkers may need reasons of units
+                    proof->remove(c->lits, c->num_lit);
+                free_clause(r);
+                continue;
+            }
+            uint new_num_lit = 0;
+            for (uint i = 0; i < c->num_lit; ++i) {
+                int lit = c->lits[i];
+                if (! defined(abs(lit)))
+                    learnt.push_back(lit);
+            }
+            if (proof && learnt.size() < c->num_lit) { // the shorter clause follows by unit propagation
+                proof->add(learnt.data(), learnt.size());
+                if (cert_deletions)
+                    proof->remove(c->lits, c->num_lit);
+            }
+            for (int lit : learnt)
+                c->lits[new_num_lit++] = lit;
+            learnt.clear();
+            arena_wasted += c->num_lit - new_num_lit;
+            c->num_lit = new_num_lit;
+            tier[new_size++] = r;
+        }
+        tier.resize(new_size);
+    }
+    sweep_watches();
+    collect_garbage();
+}
+
+uint solver::new_var() {
+    ++N;
+    model.push_back(initial_phase ? MODEL_PHASE : 0);
+    if (pos_list.size() <= N) { // otherwise the lists are left over from before `reset`
+        pos_list.emplace_back();
+        neg_list.emplace_back();
+        pos_bin.emplace_back();
+        neg_bin.emplace_back();
+        pos_card.emplace_back();
+        neg_card.emplace_back();
+        xor_watch.emplace_back();
+    }
+    vars.push_back({ 0, NO_CLAUSE });
+    seen.push_back(false);
+    level_stamp.push_back(0);
+    frozen.push_back(false);
+    eliminated.push_back(false);
+    activity.push_back(0);
+    if (seed != 0) { // a tiny random activity diversifies the initial decision order
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        activity.back() = seed * 1e-15;
+    }
+    heap_index.push_back(0);
+    queue_prev.push_back(0);
+    queue_next.push_back(0);
+    queue_stamp.push_back(0);
+    enqueue_var(N);
+    decision.push_back(0);
+    return N;
+}
+
+// Forget all variables and clauses but keep the allocated memory, so that the solver can be reused for another
+// problem without the cost of growing every vector again. The configuration is kept.
+void solver::reset() {
+    N = 0;
+    num_original = 0;
+    ok = true;
+    core.clear();
+    assumptions.clear();
+    model.resize(1);
+    trail.clear();
+    trail_lim.clear();
+    propagated = 0;
+    decision_level = 0;
+    arena.clear();
+    arena_wasted = 0;
+    for (auto lists : { &pos_list, &neg_list }) {
+        for (auto & wlist : *lists)
+            wlist.clear();
+    }
+    for (auto lists : { &pos_bin, &neg_bin }) {
+        for (auto & blist : *lists)
+            blist.clear();
+    }
+    cards.clear();
+    for (auto lists : { &pos_card, &neg_card }) {
+        for (auto & clist : *lists)
+            clist.clear();
+    }
+    xors.clear();
+    xor_pending.clear();
+    for (auto & wlist : xor_watch)
+        wlist.clear();
+    xors_detected = false;
+    xors_added = false;
+    vars.resize(1);
+    seen.resize(1);
+    level_stamp.resize(1);
+    frozen.resize(1);
+    eliminated.resize(1);
+    elim_stack.clear();
+    preprocessed = false;
+    extended = false;
+    learnt.clear();
+    for (auto & tier : db)
+        tier.clear();
+    next_reduce = 0;
+    reduce_interval = 0;
+    stable = false;
+    next_mode_switch = 0;
+    mode_interval = 0;
+    clause_increment = 1;
+    activity.resize(1);
+    heap.resize(1);
+    heap_index.resize(1);
+    activity_increment = 1;
+    bumped.clear();
+    queue_prev.resize(1);
+    queue_next.resize(1);
+    queue_stamp.resize(1);
+    queue_last = queue_search = 0;
+    restart_timer = 0;
+    restart_limit = 0;
+    luby_seq = { 1, 1 };
+    lbd_fast = { LBD_FAST_ALPHA };
+    lbd_slow = { LBD_SLOW_ALPHA };
+    trail_avg = { TRAIL_ALPHA };
+    decision.resize(1);
+    stack.clear();
+    trash.clear();
+    num_conflicts = 0;
+    num_propagations = 0;
+    next_inprocess = 0;
+    inprocess_interval = 0;
+    inprocess_propagations = 0;
+    probe_next = 0;
+    next_rephase = 0;
+    rephase_interval = 0;
+    rephase_propagations = 0;
+    stats = {};
+    simplified_trail = 0;
+}
+
+bool solver::add_clause(const int * lits, uint num_lit) {
+    if (! ok)
+        return false;
+    backjump(0);
+    if (extended)
+        retract_model();
+    for (uint i = 0; i < num_lit; ++i) {
+        while ((uint) abs(lits[i]) > N)
+            new_var();
+    }
+    ++num_original;
+    return attach(lits, num_lit, 0, -1);
+}
+
+// Add a clause at level 0. Learnt clauses received from other threads come in here as well.
+bool solver::attach(const int * lits, uint num_lit, int flags, uint score) {
+    vector<int> new_lits;
+    for (uint i = 0; i < num_lit; ++i) {
+        int lit = lits[i];
+        if (ev(abs(lit)) == lit) // satisfied at level 0
+            return true;
+        if (ev(abs(lit)) == -lit)
+            continue;
+        bool last = true;
+        for (uint j = i + 1; j < num_lit; ++j) {
+            if (lit == -lits[j]) // tautology found
+                return true;
+            if (lit == lits[j]) {
+                last = false;
+                break;
+            }
+        }
+        if (last)
+            new_lits.push_back(lit);
+    }
+    if (proof && new_lits.size() < num_lit) // the clause is kept in a shorter form
+        proof->add(new_lits.data(), new_lits.size());
+    if (new_lits.empty())
+        return ok = false;
+    if (new_lits.size() == 1) {
+        push(new_lits[0], NO_CLAUSE, 0);
+        if (find_conflict())
+            return ok = false;
+        return true;
+    }
+    if (new_lits.size() == 2) {
+        add_binary(new_lits[0], new_lits[1]);
+        return true;
+    }
+    auto r = make_clause(new_lits, flags, score);
+    uint tier = (flags & CLAUSE_LEARNT) == 0 ? (uint) TIER_CORE : lbd_tier(score);
+    set_tier(deref(r), tier);
+    db[tier].push_back(r);
+    watch_clause(r);
+    return true;
+}
+
+// Take the clauses other portfolio threads have exported since the last call. Returns false on unsatisfiability.
+bool solver::import_clauses() {
+    vector<int> lits;
+    uint lbd;
+    while (ok && exchange->pull(exchange_id, exchange_pos, lits, lbd)) {
+        if (any_of(lits.begin(), lits.end(), [&](int lit) { return eliminated[abs(lit)]; }))
+            continue;
+        backjump(0);
+        attach(lits.data(), lits.size(), CLAUSE_LEARNT, lbd);
+        STAT(++stats.imported);
+    }
+    return ok;
+}
+
+// Collect into `core` the assumptions that make assumption `lit` false.
+void solver::analyze_final(int lit) {
+    core.push_back(lit);
+    uint v = abs(lit);
+    if (vars[v].level == 0)
+        return;
+    seen[v] = true;
+    int tmp;
+    for (uint i = trail.size() - 1; i != -1u; --i) {
+        int lit = trail[i];
+        uint v = abs(lit);
+        if (! seen[v])
+            continue;
+        seen[v] = false;
+        if (vars[v].reason == NO_CLAUSE) { // below the current level every decision is an assumption
+            core.push_back(lit);
+            continue;
+        }
+        auto [begin, end] = antecedents(vars[v].reason, tmp);
+        for (auto p = begin; p != end; ++p) {
+            if (vars[abs(*p)].level > 0)
+                seen[abs(*p)] = true;
+        }
+    }
+}
+
+result solver::solve(const vector<int> & assumps) {
+    core.clear();
+    if (! ok)
+        return UNSATISFIABLE;
+    backjump(0);
+    if (extended)
+        retract_model();
+    assumptions = assumps;
+    for (int lit : assumptions) {
+        while ((uint) abs(lit) > N)
+            new_var();
+    }
+    for (int lit : assumptions)
+        frozen[abs(lit)] = true;
+    vector<xor_constraint> implied;
+    if (xor_detection && ! xors_detected && ! proof) { // before preprocessing takes the clauses apart
+        xors_detected = true;
+        implied = detect_xors();
+    }
+    if ((! xor_pending.empty() || ! implied.empty()) && ! eliminate_xors(implied))
+        return UNSATISFIABLE;
+    if (preprocessing && ! preprocessed) {
+        preprocessed = true;
+        if (! preprocess())
+            return UNSATISFIABLE;
+    }
+    if (restart_limit == 0)
+        restart_limit = restart_base;
+    if (mode_interval == 0) {
+        mode_interval = MODE_INTERVAL;
+        next_mode_switch = num_conflicts + mode_interval;
+    }
+    if (reduce_interval == 0) {
+        reduce_interval = REDUCE_INTERVAL;
+        next_reduce = num_conflicts + reduce_interval;
+    }
+    if (inprocess_interval == 0) {
+        inprocess_interval = INPROCESS_INTERVAL;
+        next_inprocess = num_conflicts + inprocess_interval;
+    }
+    if (rephase_interval == 0) {
+        rephase_interval = REPHASE_INTERVAL;
+        next_rephase = num_conflicts + rephase_interval;
+    }
+    if (walk_only && (! can_walk() || ! local_search()))
+        return UNKNOWN;
+    uint64_t conflict_limit = conflict_budget ? num_conflicts + conflict_budget : UINT64_MAX;
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double>(time_budget);
+
+    while (1) {
+        while (auto conflict = find_conflict()) {
+            if (conflict_level(*conflict) == 0) {
+                ok = false;
+                return UNSATISFIABLE;
+            }
+            if (interrupt && interrupt->load(memory_order_relaxed))
+                return UNKNOWN;
+            if (++num_conflicts >= conflict_limit)
+                return UNKNOWN;
+            if (progress && num_conflicts % progress_interval == 0)
+                progress(*this);
+            if (time_budget > 0 && num_conflicts % 128 == 0 && chrono::steady_clock::now() >= deadline)
+                return UNKNOWN;
+            uint assigned = trail.size();
+            // Blocking is meant to be the exception. With Glucose's margin of 1.4 it blocked about 40% of the restarts
+            // on random 3-SAT, most of the focused phase; 1.6 from 20000 conflicts blocks 10-20% there.
+            if (! luby_restarts && ! stable && num_conflicts > BLOCK_MIN_CONFLICTS && assigned > BLOCK_MARGIN * trail_avg.value
+                && restart_timer >= RESTART_MIN_CONFLICTS) { // maybe close to a model; postpone the restart
+                restart_timer = 0;
+                STAT(++stats.blocked_restarts);
+            }
+            trail_avg.update(assigned);
+            analyze(*conflict);
+            bump_variables();
+            decay_activity();
+            ++restart_timer;
+        }
+        simplify();
+        if (restart_due()) {
+            if (exchange && ! import_clauses()) // imports happen at restarts
+                return UNSATISFIABLE;
+            if (restart())
+                continue;
+        }
+        if (inprocessing && num_conflicts >= next_inprocess) {
+            if (! inprocess())
+                return UNSATISFIABLE;
+            continue;
+        }
+        // focused phases keep theirs
+        if (rephasing && (stable || luby_restarts) && num_conflicts >= next_rephase && can_walk()) {
+            rephase();
+            continue;
+        }
+        if (decision_level < assumptions.size()) {
+            int lit = assumptions[decision_level];
+            if (ev(abs(lit)) == -lit) {
+                analyze_final(lit);
+                return UNSATISFIABLE;
+            }
+            new_level(lit);
+            continue;
+        }
+        if (! decide()) {
+            if (! elim_stack.empty())
+                extend_model();
+            return SATISFIABLE;
+        }
+        reduce();
+    }
+}
+
+// Pick the variable to split on: among the most active unassigned variables, the one whose two branches together
+// propagate the most (the product of the counts, as in march). A variable with a failing branch is taken at once.
+uint solver::lookahead() {
+    vector<pair<double, uint>> candidates;
+    for (uint v = 1; v <= N; ++v) {
+        if (! defined(v) && ! eliminated[v])
+            candidates.emplace_back(priority(v), v);
+    }
+    if (candidates.empty())
+        return 0;
+    uint num = min<size_t>(candidates.size(), LOOKAHEAD_CANDIDATES);
+    nth_element(candidates.begin(), candidates.begin() + (num - 1), candidates.end(), greater<>());
+    uint best = 0;
+    uint64_t best_score = 0;
+    for (uint i = 0; i < num; ++i) {
+        uint v = candidates[i].second;
+        uint64_t score = 1;
+        for (int lit : { (int) v, -(int) v }) {
+            uint start = trail.size();
+            new_level(lit);
+            bool failed = find_conflict().has_value();
+            score *= trail.size() - start + 1;
+            backjump(decision_level - 1);
+            if (failed)
+                return v;
+        }
+        if (score > best_score) {
+            best_score = score;
+            best = v;
+        }
+    }
+    return best;
+}
+
+void solver::split(uint depth, vector<int> & cube, vector<vector<int>> & cubes, vector<vector<int>> & nodes) {
+    uint v = depth == 0 ? 0 : lookahead();
+    if (v == 0) {
+        cubes.push_back(cube);
+        return;
+    }
+    int first = phase(v) ? (int) v : -(int) v; // cubes following the saved phases come first
+    for (int lit : { first, -first }) {
+        cube.push_back(lit);
+        new_level(lit);
+        if (! find_conflict())
+            split(depth - 1, cube, cubes, nodes);
+        else if (proof) // refuted by propagation alone
+            proof->add(cube.data(), cube.size(), true);
+        backjump(decision_level - 1);
+        cube.pop_back();
+    }
+    nodes.push_back(cube);
+}
+
+// Split the problem into cubes of at most `depth` assumptions by lookahead. Cubes refuted by propagation are left
+// out. `nodes` receives the inner nodes of the split in post-order, ending with the empty root; once every cube is
+// refuted, writing their negations in this order closes the proof.
+void solver::make_cubes(uint depth, vector<vector<int>> & cubes, vector<vector<int>> & nodes) {
+    backjump(0);
+    assumptions.clear();
+    if (! ok || find_conflict()) {
+        ok = false;
+        nodes.emplace_back();
+        return;
+    }
+    vector<int> cube;
+    split(depth, cube, cubes, nodes);
+}
@@ -0,0 +1,381 @@
+#pragma once
+
+#include "proof.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <utility>
+#include <vector>
+
+typedef unsigned uint;
+typedef unsigned char uchar;
+
+#define ACTIVITY_DECAY_FACTOR (0.9)
+#define RESTART_BASE_INTERVAL 10 // can even be 1
+#define LBD_FAST_ALPHA (1.0 / 32) // smoothing of the moving averages that drive restarts
+#define LBD_SLOW_ALPHA (1.0 / 4096)
+#define TRAIL_ALPHA (1.0 / 4096)
+#define INPROCESS_INTERVAL 10000 // conflicts before the first inprocessing; the interval grows by as much each time
+#define REPHASE_INTERVAL 2000 // conflicts before the first rephasing by local search; the interval grows likewise
+
+enum result {
+    UNKNOWN = 0, // interrupted
+    SATISFIABLE = 10, // the values are the exit codes of the sat competition
+    UNSATISFIABLE = 20,
+};
+
+enum {
+    MODEL_DEFINED = 1,
+    MODEL_PHASE = 2,
+};
+enum {
+    CLAUSE_LEARNT = 1,
+    CLAUSE_DELETED = 4,
+    CLAUSE_RELOCATED = 8, // only during `collect_garbage`; num_lit holds the new reference
+    CLAUSE_USED = 16, // took part in a conflict since the last `reduce`
+    CLAUSE_TIER = 32 | 64, // the tier the clause belongs to, shifted by CLAUSE_TIER_SHIFT
+    CLAUSE_VIVIFIED = 128, // already tried by `vivify`
+};
+#define CLAUSE_TIER_SHIFT 5
+enum {
+    TIER_CORE, // original clauses and learnt clauses of small LBD; never reduced
+    TIER_2, // kept while they are used
+    TIER_LOCAL, // the less active half is deleted at each `reduce`
+    NUM_TIERS,
+};
+uint lbd_tier(uint lbd); // where a learnt clause of that LBD goes
+struct clause {
+    uint num_lit;
+    uint flags : 8;
+    uint score : 24; // LBD, at most MAX_SCORE
+    float activity;
+    int lits[]; // lits[0] and lits[1] are watched literals
+};
+#define MAX_SCORE ((1u << 24) - 1)
+typedef uint clause_ref; // offset of a clause in `arena`, below CARD_REASON; `make_clause` aborts past that
+#define NO_CLAUSE (~0u)
+struct watcher {
+    clause_ref cref;
+    int blocker; // another literal of the clause; if it is true the clause need not be visited
+};
+// a clause_ref, NO_CLAUSE, BINARY_REASON | encoded other literal of a binary clause, CARD_REASON | index in `cards`,
+// or XOR_REASON | index in `xors`
+typedef uint reason_ref;
+#define BINARY_REASON (1u << 31)
+#define CARD_REASON (1u << 30)
+#define XOR_REASON (CARD_REASON | 1u << 29) // so indices of cardinality constraints stay below 1 << 29
+struct var_info { // together, since `analyze` reads both for every variable it visits
+    uint level;
+    reason_ref reason; // NO_CLAUSE for decision
+};
+struct card_constraint { // at most `bound` of `lits` are true
+    uint bound;
+    uint num_true; // how many of `lits` are true now; kept by `push` and `backjump`
+    std::vector<int> lits;
+    std::vector<int> reason; // the negations of the true literals when the constraint last implied the others false
+};
+struct xor_constraint { // the variables add up to `rhs` modulo 2
+    bool rhs;
+    uint implied; // the variable it implied last
+    std::vector<uint> vars; // vars[0] and vars[1] are watched
+};
+struct clause_exchange;
+struct heap_node {
+    double activity; // a copy of the variable's, so that comparisons need not look it up
+    uint var;
+};
+
+// Search statistics. They are cheap enough to keep; build with -DNO_STATS to compile the counters and timers out.
+#ifdef NO_STATS
+#define STAT(x) ((void) 0)
+#define TIME_PHASE(p) ((void) 0)
+#else
+#define STAT(x) ((void) (x))
+#define TIME_PHASE(p) phase_timer phase_timer_(stats.time[p])
+#endif
+enum {
+    PHASE_PROPAGATE,
+    PHASE_ANALYZE,
+    PHASE_REDUCE,
+    PHASE_SIMPLIFY,
+    PHASE_PREPROCESS,
+    PHASE_PROBE,
+    PHASE_VIVIFY,
+    PHASE_SUBSTITUTE,
+    PHASE_WALK,
+    PHASE_GAUSS,
+    NUM_PHASES,
+};
+struct solver_stats {
+    uint64_t decisions = 0;
+    uint64_t restarts = 0;
+    uint64_t blocked_restarts = 0;
+    uint64_t chrono_backtracks = 0; // conflicts after which only one level was undone
+    uint64_t reductions = 0;
+    uint64_t simplifications = 0;
+    uint64_t learnt = 0; // clauses
+    uint64_t learnt_literals = 0;
+    uint64_t learnt_lbd = 0;
+    uint64_t deleted = 0; // learnt clauses removed by `reduce`
+    uint64_t promoted = 0; // learnt clauses moved to a better tier as their LBD improved
+    uint64_t demoted = 0; // tier-2 clauses moved to the local tier for lack of use
+    uint64_t imported = 0; // clauses taken from `exchange`
+    uint64_t eliminated_vars = 0;
+    uint64_t subsumed = 0; // by preprocessing
+    uint64_t strengthened = 0; // literals removed by self-subsumption
+    uint64_t inprocessings = 0;
+    uint64_t failed_literals = 0; // units found by probing
+    uint64_t vivified = 0; // clauses shortened by vivification
+    uint64_t vivified_literals = 0; // literals removed by vivification
+    uint64_t substituted = 0; // variables replaced by an equivalent literal
+    uint64_t substituted_clauses = 0; // clauses rewritten by the substitution
+    uint64_t walks = 0; // runs of local search
+    uint64_t flips = 0;
+    uint64_t xors = 0; // XOR constraints found among the clauses
+    uint64_t eliminations = 0; // runs of Gauss-Jordan elimination
+    uint64_t xor_units = 0; // units and equivalences found by the elimination
+    double time[NUM_PHASES] = {}; // seconds
+};
+struct ema { // exponential moving average; the plain average until there are 1 / alpha samples
+    double alpha;
+    double value = 0;
+    uint64_t n = 0;
+    void update(double x) {
+        ++n;
+        value += (1.0 / n > alpha ? 1.0 / n : alpha) * (x - value);
+    }
+};
+struct phase_timer { // adds the time until it goes out of scope
+    double & total;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    phase_timer(double & total) : total(total) {
+    }
+    ~phase_timer() {
+        total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// A CDCL solver. Clauses may be added between calls to `solve`; learnt clauses, activities and phases are kept
+// across calls, so a sequence of related queries can be answered by one instance.
+struct solver {
+    // interface
+    proof_writer * proof = nullptr;
+    bool cert_deletions = true; // false if the proof is shared with other solvers, whose copies may still be in use
+    std::vector<int> core; // after an unsatisfiable `solve`, the assumptions that are inconsistent with the clauses
+    // configuration; set before adding clauses
+    double activity_decay = ACTIVITY_DECAY_FACTOR;
+    bool luby_restarts = false; // only Luby restarts; otherwise phases of LBD-driven restarts are interleaved
+    uint restart_base = RESTART_BASE_INTERVAL; // for Luby restarts
+    bool initial_phase = false; // phase of a variable that has never been assigned
+    bool vmtf = false; // decide by the variable-move-to-front queue instead of VSIDS; set before adding variables
+    bool preprocessing = false; // simplify the clauses before the first search; see `freeze`
+    bool inprocessing = false; // simplify the clauses now and then during the search; see `freeze`
+    bool rephasing = false; // now and then replace the phases by the best assignment local search finds from them
+    bool walk_only = false; // search by local search alone, which cannot show unsatisfiability
+    // Local search sees only the clauses, so neither of the two above takes effect once cardinality constraints or
+    // XOR constraints of `add_xor` are added: `solve` does not rephase, and returns UNKNOWN instead of walking. It has
+    // no conflicts either, so `walk_only` is bounded by `time_budget` alone.
+    bool xor_detection = false; // add XOR constraints found among the original clauses to the first elimination
+    uint seed = 0; // nonzero to randomize the initial variable order
+    std::atomic<bool> * interrupt = nullptr; // `solve` returns UNKNOWN soon after this becomes true
+    clause_exchange * exchange = nullptr; // learnt clauses are shared through this
+    uint exchange_id = 0;
+    uint64_t conflict_budget = 0; // per call to `solve`; 0 for no limit
+    double time_budget = 0; // seconds per call to `solve`; 0 for no limit
+    void (*progress)(const solver &) = nullptr; // called every `progress_interval` conflicts
+    uint64_t progress_interval = 10000;
+
+    uint num_vars() const {
+        return N;
+    }
+    uint new_var();
+    bool add_clause(const int * lits, uint num_lit); // false if the clauses became unsatisfiable
+    bool add_clause(const std::vector<int> & lits) {
+        return add_clause(lits.data(), lits.size());
+    }
+    // At most `bound` of the literals, taken as a set, may be true. The constraint is propagated natively, without
+    // clauses; its variables are frozen. Proofs do not cover it.
+    bool add_at_most(const int * lits, uint num_lit, uint bound);
+    bool add_at_most(const std::vector<int> & lits, uint bound) {
+        return add_at_most(lits.data(), lits.size(), bound);
+    }
+    bool add_exactly_one(const std::vector<int> & lits) {
+        return add_clause(lits) && add_at_most(lits, 1);
+    }
+    // The literals add up to true modulo 2. XOR constraints go through Gauss-Jordan elimination at the next `solve`
+    // and are propagated natively; their variables are frozen. Proofs do not cover them.
+    bool add_xor(const int * lits, uint num_lit);
+    bool add_xor(const std::vector<int> & lits) {
+        return add_xor(lits.data(), lits.size());
+    }
+    result solve(const std::vector<int> & assumptions = {}); // UNKNOWN if interrupted or out of budget
+    int value(uint var) const { // var, -var, or 0 if unassigned; the model is valid until the next change
+        return ev(var);
+    }
+    void reset();
+    // Keep var from being eliminated by preprocessing or inprocessing. Variables of clauses added after the first
+    // call to `solve` and of assumptions of later calls must be frozen beforehand; those of the assumptions of the
+    // current call are frozen automatically.
+    void freeze(uint var);
+    void make_cubes(uint depth, std::vector<std::vector<int>> & cubes, std::vector<std::vector<int>> & nodes);
+
+    // state
+    uint N = 0; // number of variables
+    uint num_original = 0; // number of clauses given to `add_clause`
+    bool ok = true; // false once the clauses are known to be unsatisfiable
+    std::vector<int> assumptions; // assumptions[i] is decided at level i + 1
+    std::vector<uchar> model { 0 };
+    std::vector<int> trail;
+    std::vector<uint> trail_lim; // trail_lim[i] is where level i + 1 starts on the trail
+    uint propagated = 0; // the literals on the trail from here are yet to be propagated
+    uint decision_level = 0;
+    std::vector<uint> arena; // all clauses (header followed by literals), laid out contiguously
+    uint arena_wasted = 0; // words held by deleted clauses and removed literals
+    std::vector<std::vector<watcher>> pos_list { {} }, neg_list { {} }; // watch lists
+    std::vector<std::vector<int>> pos_bin { {} }, neg_bin { {} }; // binary clauses; bin_list(lit) holds the literals implied when lit is false
+    std::vector<card_constraint> cards;
+    std::vector<std::vector<uint>> pos_card { {} }, neg_card { {} }; // card_list(lit) holds the constraints with lit
+    std::vector<xor_constraint> xors; // watched
+    std::vector<xor_constraint> xor_pending; // added since the last elimination
+    std::vector<std::vector<uint>> xor_watch { {} }; // by variable
+    std::vector<int> xor_reason; // only used in `antecedents`
+    bool xors_detected = false;
+    bool xors_added = false; // by `add_xor`; those found among the clauses are still there as clauses
+    std::vector<var_info> vars { { 0, NO_CLAUSE } }; // level and reason of the assigned variables
+    int binary_conflict[2]; // literals of the conflicting binary clause
+    std::vector<int> constraint_conflict; // the false literals of a violated cardinality or XOR constraint, as a clause
+    std::vector<bool> seen { false }; // only used in `analyze`
+    std::vector<uint> level_stamp { 0 }; // by level; equal to `lbd_stamp` if counted by the current `compute_lbd`
+    uint lbd_stamp = 0;
+    std::vector<bool> frozen { false }, eliminated { false };
+    std::vector<int> elim_stack; // clauses removed by elimination, each followed by its size; the eliminated literal first
+    bool preprocessed = false;
+    bool extended = false; // eliminated variables are assigned by `extend_model`
+    std::vector<int> learnt; // only used in `analyze` and `simplify`
+    std::array<std::vector<clause_ref>, NUM_TIERS> db; // all clauses but binary ones, by tier
+    uint64_t next_reduce = 0; // conflict count of the next `reduce`
+    uint reduce_interval = 0;
+    double clause_increment = 1;
+    std::vector<double> activity { 0 }; // variable activity
+    std::vector<heap_node> heap { {} }; // 4-ary max-heap of variables by activity; heap[0] is not used
+    std::vector<uint> heap_index { 0 }; // variable to index in heap; 0 if variable not in heap
+    double activity_increment = 1;
+    std::vector<uint> bumped; // variables to bump at the end of `analyze`
+    std::vector<uint> queue_prev { 0 }, queue_next { 0 }; // VMTF: variables in a list in order of their last bump
+    std::vector<uint64_t> queue_stamp { 0 }; // increasing along the list
+    uint queue_last = 0;
+    uint queue_search = 0; // the variables after it in the list are all assigned
+    uint64_t num_queue_stamps = 0;
+    uint restart_timer = 0; // conflicts since the last restart
+    uint restart_limit = 0; // for Luby restarts
+    bool stable = false; // in a phase of Luby restarts
+    uint64_t next_mode_switch = 0;
+    uint mode_interval = 0;
+    ema lbd_fast { LBD_FAST_ALPHA }, lbd_slow { LBD_SLOW_ALPHA }; // of learnt clauses
+    ema trail_avg { TRAIL_ALPHA }; // number of assigned variables at conflicts
+    std::array<int, 2> luby_seq { 1, 1 }; // reluctant doubling
+    std::vector<uint> decision { 0 }; // for parital restarts
+    std::vector<std::pair<uint, bool>> stack; // only used in `analyze`
+    std::vector<uint> trash; // only used in `analyze`
+    uint64_t exchange_pos = 0; // next clause to read from `exchange`
+    uint64_t num_conflicts = 0;
+    uint64_t num_propagations = 0; // literals taken from the trail by `find_conflict`
+    uint64_t next_inprocess = 0; // conflict count of the next `inprocess`
+    uint inprocess_interval = 0;
+    uint64_t inprocess_propagations = 0; // `num_propagations` at the last `inprocess`
+    uint probe_next = 0; // variable `probe` stopped at
+    uint64_t next_rephase = 0; // conflict count of the next `rephase`
+    uint rephase_interval = 0;
+    uint64_t rephase_propagations = 0; // `num_propagations` at the last `rephase`
+    solver_stats stats;
+    uint simplified_trail = 0; // size of the level 0 trail at the last `simplify`
+
+    bool defined(uint var) const {
+        return (model[var] & MODEL_DEFINED) != 0;
+    }
+    bool phase(uint var) const {
+        return (model[var] & MODEL_PHASE) != 0;
+    }
+    int ev(uint var) const {
+        return ! defined(var) ? 0 : phase(var) ? (int) var : -(int) var;
+    }
+
+    void heap_up(uint i);
+    void heap_down(uint i);
+    void heap_push(uint v);
+    void heap_pop();
+    void queue_append(uint v);
+    void queue_remove(uint v);
+    void enqueue_var(uint v);
+    uint next_decision();
+    double priority(uint v);
+    void rebuild_queue();
+
+    clause * deref(clause_ref r) {
+        return reinterpret_cast<clause *>(&arena[r]);
+    }
+    std::pair<const int *, const int *> antecedents(reason_ref r, int & tmp);
+    bool locked(clause_ref r);
+    void push(int lit, reason_ref r, uint lv);
+    clause_ref make_clause(const std::vector<int> & lits, int flags, uint score);
+    void free_clause(clause_ref r);
+    std::vector<watcher> & watch_list(int lit) {
+        return lit > 0 ? pos_list[lit] : neg_list[-lit];
+    }
+    std::vector<int> & bin_list(int lit) {
+        return lit > 0 ? pos_bin[lit] : neg_bin[-lit];
+    }
+    std::vector<uint> & card_list(int lit) {
+        return lit > 0 ? pos_card[lit] : neg_card[-lit];
+    }
+    void add_binary(int a, int b);
+    void watch_clause(clause_ref r);
+    void sweep_watches();
+    void bump_variables();
+    void decay_activity();
+    void bump_clause(clause * c);
+    void note_lbd(uint lbd);
+    void backjump(uint level);
+    uint compute_lbd(const int * lits, uint num_lit);
+    void update_lbd(clause * c);
+    std::pair<int *, uint> conflict_lits(reason_ref confl);
+    uint conflict_level(reason_ref confl);
+    void analyze(reason_ref confl);
+    void analyze_final(int lit);
+    bool attach(const int * lits, uint num_lit, int flags, uint score);
+    bool import_clauses();
+    uint reason_level(const clause * c);
+    bool propagate_card(uint index);
+    std::optional<reason_ref> propagate_xors(uint var);
+    void watch_xor(uint index);
+    std::vector<xor_constraint> detect_xors();
+    bool simplify_xor(xor_constraint & x);
+    bool eliminate_xors(const std::vector<xor_constraint> & implied);
+    std::optional<reason_ref> find_conflict();
+    int choose();
+    void new_level(int lit);
+    bool decide();
+    void collect_garbage();
+    void reduce();
+    bool restart_due();
+    bool restart();
+    void simplify();
+    bool preprocess();
+    void purge_deleted();
+    bool inprocess();
+    bool probe(uint64_t budget);
+    bool vivify(uint64_t budget);
+    bool substitute();
+    bool can_walk() const;
+    bool walk(uint64_t flips);
+    void rephase();
+    bool local_search();
+    void extend_model();
+    void retract_model();
+    uint lookahead();
+    void split(uint depth, std::vector<int> & cube, std::vector<std::vector<int>> & cubes,
+        std::vector<std::vector<int>> & nodes);
+};
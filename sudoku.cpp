@@ -1,145 +1,206 @@
+#include "sink.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
 #include <vector>
 extern "C" {
 #include <unistd.h>
 }
 
-#define SOLVER "./sat_opt"
-
 using namespace std;
 
-FILE *to_solver, *from_solver;
+// A grid of order n has N = n * n rows, columns, boxes and digits. Cells are written '1'..'9' and then 'A'.., and
+// '0' or '.' for blank.
+int n = 3, N = 9;
 
-void spawn_solver() {
-    int to_child[2], from_child[2]; 
-    if (pipe(to_child) < 0)
-        perror("pipe1");
-    if (pipe(from_child) < 0)
-        perror("pipe2");
-    pid_t pid;
-    if ((pid = vfork()) < 0)
-        perror("vfork");
-    if (pid == 0) { // in solver
-        close(to_child[1]);
-        close(from_child[0]);
-        dup2(to_child[0], 0);
-        dup2(from_child[1], 1);
-        close(to_child[0]);
-        close(from_child[1]);
-        if (execl(SOLVER, SOLVER, NULL) < 0)
-            perror("execl");
-    }
-    close(to_child[0]);
-    close(from_child[1]);
-    to_solver = fdopen(to_child[1], "w");
-    from_solver = fdopen(from_child[0], "r");
-}
+int p(int i, int j, int d) { return (i*N + j)*N + d + 1; }
 
-int p(int i, int j, int n) { return (i*81 + j*9 + n) + 1; }
+int cell_value(char c) { // digit - 1, -1 for blank, or at least N if c is no cell of this order
+    if (c >= '1' && c <= '9')
+        return c - '1';
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 9;
+    if (c == '0' || c == '.')
+        return -1;
+    return N;
+}
+char cell_char(int d) {
+    return d < 9 ? '1' + d : 'A' + d - 9;
+}
 
-void solve() {
-    int b[9][9];
+void exactly_one(clause_sink & db, const vector<int> & c) {
+    db.add(c);
+    db.add_at_most(c, 1); // natively in the solver, instead of a binary clause for every pair
+}
 
-    // read initial states
-    for (int i = 0; i < 9; ++i) {
-        for (int j = 0; j < 9; ++j) {
-            char c;
-            scanf(" %c", &c);
-            b[i][j] = c - '0';
+// The constraints that every puzzle shares; the givens are left to assumptions. Each cell holds exactly one digit,
+// and each digit is in exactly one cell of every row, column and box. Only "at least one" is needed for the last
+// three, but "at most one" lets propagation fill cells without search.
+void encode(clause_sink & db) {
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            vector<int> c;
+            for (int d = 0; d < N; ++d)
+                c.push_back(p(i,j,d));
+            exactly_one(db, c);
         }
     }
-
-    // construct cnf
-    vector<vector<int>> db;
-    for (int i = 0; i < 9; ++i) {
-        for (int j = 0; j < 9; ++j) {
-            if (b[i][j] != 0)
-                db.push_back({ p(i,j,b[i][j] - 1) });
+    for (int i = 0; i < N; ++i) {
+        for (int d = 0; d < N; ++d) {
+            vector<int> c;
+            for (int j = 0; j < N; ++j)
+                c.push_back(p(i,j,d));
+            exactly_one(db, c);
         }
     }
-    for (int i = 0; i < 9; ++i) {
-        for (int j = 0; j < 9; ++j) {
+    for (int j = 0; j < N; ++j) {
+        for (int d = 0; d < N; ++d) {
             vector<int> c;
-            for (int n = 0; n < 9; ++n)
-                c.push_back(p(i,j,n));
-            db.push_back(move(c));
+            for (int i = 0; i < N; ++i)
+                c.push_back(p(i,j,d));
+            exactly_one(db, c);
         }
     }
-    for (int i = 0; i < 9; ++i) {
-        for (int j = 0; j < 9; ++j) {
-            for (int x = 0; x < 8; ++x) {
-                for (int y = x + 1; y < 9; ++y) {
-                    vector<int> c;
-                    c.push_back(-p(i,j,x));
-                    c.push_back(-p(i,j,y));
-                    db.push_back(move(c));
-                }
+    for (int r = 0; r < n; ++r) {
+        for (int s = 0; s < n; ++s) {
+            for (int d = 0; d < N; ++d) {
+                vector<int> c;
+                for (int i = 0; i < n; ++i)
+                    for (int j = 0; j < n; ++j)
+                        c.push_back(p(n*r+i,n*s+j,d));
+                exactly_one(db, c);
             }
         }
     }
-    for (int i = 0; i < 9; ++i) {
-        for (int n = 0; n < 9; ++n) {
-            vector<int> c;
-            for (int j = 0; j < 9; ++j)
-                c.push_back(p(i,j,n));
-            db.push_back(move(c));
-        }
+}
+
+// Solve the puzzle given as N * N cells in row order, in place; false if it has no solution.
+bool solve(solver & S, string & cells) {
+    vector<int> givens;
+    for (int k = 0; k < N*N; ++k) {
+        int d = cell_value(cells[k]);
+        if (d >= 0)
+            givens.push_back(p(k / N, k % N, d));
     }
-    for (int j = 0; j < 9; ++j) {
-        for (int n = 0; n < 9; ++n) {
-            vector<int> c;
-            for (int i = 0; i < 9; ++i)
-                c.push_back(p(i,j,n));
-            db.push_back(move(c));
+    if (S.solve(givens) != SATISFIABLE)
+        return false;
+    for (int k = 0; k < N*N; ++k) {
+        for (int d = 0; d < N; ++d) {
+            if (S.value(p(k / N, k % N, d)) > 0)
+                cells[k] = cell_char(d);
         }
     }
-    for (int r = 0; r < 3; ++r) {
-        for (int s = 0; s < 3; ++s) {
-            for (int n = 0; n < 9; ++n) {
-                vector<int> c;
-                for (int i = 0; i < 3; ++i)
-                    for (int j = 0; j < 3; ++j)
-                        c.push_back(p(3*r+i,3*s+j,n));
-                db.push_back(move(c));
+    return true;
+}
+
+// Batch mode: read one puzzle per line and print the solutions in the same order, each on a line, or "-" for a
+// puzzle without one. Every worker keeps one solver with the shared constraints and solves its puzzles under
+// assumptions, so the encoding is built once per worker and learnt clauses carry over between puzzles.
+void run_batch(unsigned num_threads) {
+    vector<string> puzzles;
+    char * line = nullptr;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, stdin)) > 0) {
+        string s;
+        for (ssize_t k = 0; k < len; ++k) {
+            if (line[k] != ' ' && line[k] != '\t' && line[k] != '\r' && line[k] != '\n')
+                s += line[k];
+        }
+        if (s.empty())
+            continue;
+        if ((int) s.size() != N*N) {
+            fprintf(stderr, "puzzle %zu: %d cells expected\n", puzzles.size() + 1, N*N);
+            exit(1);
+        }
+        for (char c : s) {
+            if (cell_value(c) >= N) {
+                fprintf(stderr, "puzzle %zu: invalid cell '%c'\n", puzzles.size() + 1, c);
+                exit(1);
             }
         }
+        puzzles.push_back(move(s));
     }
+    free(line);
 
-    // send cnf to solver
-    fprintf(to_solver, "p cnf %d %lu\n", 9*9*9, db.size());
-    for (auto & c : db) {
-        for (auto lit : c) {
-            fprintf(to_solver, "%d ", lit);
-        }
-        fprintf(to_solver, "0\n");
+    auto start = chrono::steady_clock::now();
+    vector<char> solved(puzzles.size());
+    atomic<size_t> next { 0 };
+    vector<thread> workers;
+    for (unsigned t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&] {
+            solver S;
+            solver_sink db(S);
+            encode(db);
+            for (size_t k; (k = next++) < puzzles.size();)
+                solved[k] = solve(S, puzzles[k]);
+        });
     }
-    fflush(to_solver);
+    for (auto & w : workers)
+        w.join();
+    chrono::duration<double> t = chrono::steady_clock::now() - start;
 
-    // receive answer from solver
-    fscanf(from_solver, "s SATISFIABLE v ");
-    while (1) {
-        int p;
-        fscanf(from_solver, "%d", &p);
-        if (p == 0)
+    for (size_t k = 0; k < puzzles.size(); ++k)
+        puts(solved[k] ? puzzles[k].c_str() : "-");
+    fprintf(stderr, "%zu puzzles in %.3f s, %.1f puzzles/s\n", puzzles.size(), t.count(),
+        puzzles.size() / max(t.count(), 1e-9));
+}
+
+int main(int argc, char * argv[]) {
+    bool opt_batch = false;
+    unsigned opt_threads = max(thread::hardware_concurrency(), 1u);
+    int c;
+    while ((c = getopt(argc, argv, "bj:n:")) != -1) {
+        switch (c) {
+        case 'b':
+            opt_batch = true;
             break;
-        if (p < 0)
-            continue;
-        --p;
-        int i = p / 81;
-        int j = (p % 81) / 9;
-        int n = p % 9;
-        b[i][j] = n + 1;
+        case 'j':
+            opt_threads = max(atoi(optarg), 1);
+            break;
+        case 'n':
+            n = atoi(optarg);
+            break;
+        default:
+            fputs("usage: sudoku [-b] [-j THREADS] [-n ORDER] < PUZZLES\n", stderr);
+            return 1;
+        }
+    }
+    if (n < 1 || n > 5) { // digits run out after 'Z'
+        fputs("the order must be between 1 and 5\n", stderr);
+        return 1;
+    }
+    N = n * n;
+    if (opt_batch) {
+        run_batch(opt_threads);
+        return 0;
     }
 
-    for (int i = 0; i < 9; ++i) {
-        for (int j = 0; j < 9; ++j) {
-            printf("%d", b[i][j]);
+    // read initial states
+    string cells;
+    for (int k = 0; k < N*N; ++k) {
+        char c;
+        if (scanf(" %c", &c) != 1) {
+            fputs("unexpected end of input\n", stderr);
+            return 1;
         }
-        printf("\n");
+        if (cell_value(c) >= N) {
+            fprintf(stderr, "invalid cell '%c'\n", c);
+            return 1;
+        }
+        cells += c;
     }
-}
-
-int main() {
-    spawn_solver();
-    solve();
+    solver S;
+    solver_sink db(S);
+    encode(db);
+    if (! solve(S, cells)) {
+        puts("no solution");
+        return 1;
+    }
+    for (int i = 0; i < N; ++i)
+        printf("%s\n", cells.substr(i * N, N).c_str());
 }
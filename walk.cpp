@@ -0,0 +1,254 @@
+#include "solver.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+#define WALK_EFFORT 0.2 // flips allowed for rephasing, relative to the propagations of the search since the last walk
+#define WALK_MIN_FLIPS 100000
+#define WALK_CHECK_FLIPS 100000 // flips between checks of the interrupt flag and the time budget in `local_search`
+
+// ProbSAT (Balint and Schöning) on the original clauses that are not satisfied at level 0. Repeatedly pick a random
+// false clause and flip one of its variables, chosen with a probability that falls exponentially with its break count,
+// the number of clauses the flip would make false. A clause keeps its number of true literals and the xor of their
+// variables, which is the one true variable when there is only one, so every flip updates the break counts in one
+// pass over the occurrences of the flipped variable. The false clauses are kept in a set with positions, so that one
+// can be picked at random.
+struct walker {
+    solver & S;
+    vector<int> lits; // literals of all clauses, laid out contiguously
+    vector<uint> start { 0 }; // clause i is lits[start[i]] .. lits[start[i + 1] - 1]
+    vector<uint> occ_start, occ; // clauses with a literal, by `index`, laid out contiguously as well
+    vector<uint> num_true, critical; // by clause
+    vector<uint> breaks; // by variable
+    vector<uint> unsat, unsat_pos; // the false clauses, and the position of each in `unsat`
+    vector<bool> value, best; // by variable
+    uint best_unsat;
+    vector<uint> changes; // variables flipped since `best`, unless there were too many
+    bool changes_lost = false;
+    vector<double> table; // probability weight by break count
+    vector<double> weight; // of the literals of the clause being picked from
+    uint64_t rng;
+
+    walker(solver & S) : S(S), value(S.N + 1), rng(0x9e3779b97f4a7c15ull ^ S.num_conflicts ^ S.seed) {
+    }
+    static uint index(int lit) {
+        return 2 * abs(lit) + (lit < 0);
+    }
+    uint64_t random() { // xorshift
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    }
+    uint size() const {
+        return start.size() - 1;
+    }
+
+    void add(const int * begin, const int * end) {
+        uint size = lits.size();
+        for (auto p = begin; p != end; ++p) {
+            int lit = *p;
+            if (S.ev(abs(lit)) == lit) {
+                lits.resize(size);
+                return;
+            }
+            if (! S.defined(abs(lit)))
+                lits.push_back(lit);
+        }
+        if (lits.size() > size)
+            start.push_back(lits.size());
+    }
+    void load() {
+        for (uint v = 1; v <= S.N; ++v) {
+            for (int a : { (int) v, -(int) v }) {
+                for (int b : S.bin_list(a)) {
+                    int pair[2] = { a, b };
+                    if (index(a) < index(b))
+                        add(pair, pair + 2);
+                }
+            }
+        }
+        for (auto r : S.db[TIER_CORE]) {
+            auto c = S.deref(r);
+            if ((c->flags & CLAUSE_LEARNT) == 0)
+                add(c->lits, c->lits + c->num_lit);
+        }
+        occ_start.assign(2 * S.N + 3, 0);
+        for (int lit : lits)
+            ++occ_start[index(lit) + 1];
+        for (uint i = 1; i < occ_start.size(); ++i)
+            occ_start[i] += occ_start[i - 1];
+        occ.resize(lits.size());
+        vector<uint> fill(occ_start.begin(), occ_start.end() - 1);
+        for (uint i = 0; i < size(); ++i) {
+            for (uint k = start[i]; k < start[i + 1]; ++k)
+                occ[fill[index(lits[k])]++] = i;
+        }
+        // the base of the exponential for the average clause length, as tuned for uniform random k-SAT
+        static const double bases[] = { 2.5, 2.5, 2.5, 2.5, 2.85, 3.7, 5.1, 7.4 };
+        uint k = size() == 0 ? 3 : (lits.size() + size() / 2) / size();
+        double base = bases[min<uint>(k, 7)];
+        for (double w = 1; w > 1e-300; w /= base)
+            table.push_back(w);
+    }
+
+    void make_unsat(uint c) {
+        unsat_pos[c] = unsat.size();
+        unsat.push_back(c);
+    }
+    void make_sat(uint c) {
+        uint last = unsat.back();
+        unsat[unsat_pos[c]] = last;
+        unsat_pos[last] = unsat_pos[c];
+        unsat.pop_back();
+    }
+    // Start from the saved phases.
+    void init() {
+        for (uint v = 1; v <= S.N; ++v)
+            value[v] = S.phase(v);
+        num_true.assign(size(), 0);
+        critical.assign(size(), 0);
+        breaks.assign(S.N + 1, 0);
+        unsat_pos.resize(size());
+        for (uint i = 0; i < size(); ++i) {
+            for (uint k = start[i]; k < start[i + 1]; ++k) {
+                int lit = lits[k];
+                if (value[abs(lit)] == (lit > 0)) {
+                    ++num_true[i];
+                    critical[i] ^= abs(lit);
+                }
+            }
+            if (num_true[i] == 0)
+                make_unsat(i);
+            else if (num_true[i] == 1)
+                ++breaks[critical[i]];
+        }
+        best = value;
+        best_unsat = unsat.size();
+    }
+
+    void flip(uint v) {
+        value[v] = ! value[v];
+        int lit = value[v] ? (int) v : -(int) v;
+        for (uint k = occ_start[index(lit)]; k < occ_start[index(lit) + 1]; ++k) { // now true
+            uint c = occ[k];
+            if (num_true[c] == 0) {
+                make_sat(c);
+                ++breaks[v];
+            } else if (num_true[c] == 1) {
+                --breaks[critical[c]];
+            }
+            ++num_true[c];
+            critical[c] ^= v;
+        }
+        for (uint k = occ_start[index(-lit)]; k < occ_start[index(-lit) + 1]; ++k) { // now false
+            uint c = occ[k];
+            --num_true[c];
+            critical[c] ^= v;
+            if (num_true[c] == 0) {
+                make_unsat(c);
+                --breaks[v];
+            } else if (num_true[c] == 1) {
+                ++breaks[critical[c]];
+            }
+        }
+        if (changes.size() < S.N) {
+            changes.push_back(v);
+        } else {
+            changes.clear();
+            changes_lost = true;
+        }
+    }
+    // the assignment with fewest false clauses so far becomes `best`
+    void save_best() {
+        if (changes_lost) {
+            best = value;
+        } else {
+            for (uint v : changes)
+                best[v] = ! best[v];
+        }
+        changes.clear();
+        changes_lost = false;
+        best_unsat = unsat.size();
+    }
+
+    // Flip up to `flips` times; false if no model was found.
+    bool walk(uint64_t flips) {
+        for (; flips > 0 && ! unsat.empty(); --flips) {
+            uint c = unsat[random() % unsat.size()];
+            double sum = 0;
+            weight.clear();
+            for (uint k = start[c]; k < start[c + 1]; ++k) {
+                uint b = breaks[abs(lits[k])];
+                weight.push_back(table[min<uint>(b, table.size() - 1)]);
+                sum += weight.back();
+            }
+            double x = (random() >> 11) * 0x1p-53 * sum;
+            uint k = 0;
+            while (k + 1 < weight.size() && (x -= weight[k]) >= 0)
+                ++k;
+            flip(abs(lits[start[c] + k]));
+            STAT(++S.stats.flips);
+            if (unsat.size() < best_unsat)
+                save_best();
+        }
+        return unsat.empty();
+    }
+    void set_phases(const vector<bool> & values) {
+        for (uint v = 1; v <= S.N; ++v) {
+            if (! S.defined(v) && ! S.eliminated[v])
+                S.model[v] = values[v] ? MODEL_PHASE : 0;
+        }
+    }
+};
+
+// The walker scores only clauses. With cardinality or native XOR constraints, its best assignment may violate them,
+// so it would rephase towards assignments that are no models.
+bool solver::can_walk() const {
+    return cards.empty() && ! xors_added;
+}
+
+// Local search from the saved phases, which are then replaced by the best assignment found. As the search follows
+// the phases, that takes it to a model if one was found. Must be called at level 0. Returns true if a model was found.
+bool solver::walk(uint64_t flips) {
+    TIME_PHASE(PHASE_WALK);
+    STAT(++stats.walks);
+    walker W(*this);
+    W.load();
+    W.init();
+    bool found = W.walk(flips);
+    W.set_phases(W.best);
+    return found;
+}
+
+// Rephase from the search's own phases: a local search started from them usually finds an assignment that satisfies
+// more clauses nearby.
+void solver::rephase() {
+    backjump(0);
+    rephase_interval += REPHASE_INTERVAL;
+    next_rephase = num_conflicts + rephase_interval;
+    uint64_t flips = (num_propagations - rephase_propagations) * WALK_EFFORT;
+    walk(max<uint64_t>(flips, WALK_MIN_FLIPS));
+    rephase_propagations = num_propagations;
+}
+
+// Local search alone, until it finds a model or runs out of time; it cannot show that there is none. Returns false
+// if it was interrupted or out of time.
+bool solver::local_search() {
+    auto deadline = chrono::steady_clock::now() + chrono::duration<double>(time_budget);
+    backjump(0);
+    TIME_PHASE(PHASE_WALK);
+    STAT(++stats.walks);
+    walker W(*this);
+    W.load();
+    W.init();
+    while (! W.walk(WALK_CHECK_FLIPS)) {
+        if (interrupt && interrupt->load(memory_order_relaxed))
+            return false;
+        if (time_budget > 0 && chrono::steady_clock::now() >= deadline)
+            return false;
+    }
+    W.set_phases(W.value);
+    return true;
+}
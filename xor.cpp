@@ -0,0 +1,263 @@
+#include "solver.h"
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+#define XOR_DETECT_MAX_SIZE 6 // longest XOR looked for among the clauses; it takes 2^(k-1) clauses of length k
+#define GAUSS_MAX_WORDS (1u << 24) // largest matrix, in 64-bit words, that `eliminate_xors` reduces
+
+// XOR constraints are kept apart from the clauses as rows: variables that add up to `rhs` modulo 2. Whenever new
+// ones have been added, `solve` brings all of them, and those found among the clauses, into reduced row echelon form
+// with the variables assigned at level 0 taken out, which finds the units and equivalences the system implies. During
+// the search a row is watched by two of its variables like a clause, and implies the last one when all others are
+// assigned. Its reason, the clause that excludes the current values of the others, is read off the row only when
+// `analyze` asks for it.
+
+bool solver::add_xor(const int * lits, uint num_lit) {
+    if (! ok)
+        return false;
+    backjump(0);
+    if (extended)
+        retract_model();
+    xor_constraint x { true, 0, {} };
+    for (uint i = 0; i < num_lit; ++i) {
+        int lit = lits[i];
+        while ((uint) abs(lit) > N)
+            new_var();
+        x.rhs ^= lit < 0;
+        x.vars.push_back(abs(lit));
+    }
+    sort(x.vars.begin(), x.vars.end());
+    uint size = 0;
+    for (uint v : x.vars) {
+        if (size > 0 && x.vars[size - 1] == v) // v + v = 0
+            --size;
+        else
+            x.vars[size++] = v;
+    }
+    x.vars.resize(size);
+    if (x.vars.empty())
+        return ok = ! x.rhs;
+    for (uint v : x.vars)
+        frozen[v] = true;
+    xor_pending.push_back(move(x));
+    xors_added = true;
+    return true;
+}
+
+// The original clauses of length 3 to XOR_DETECT_MAX_SIZE that, together, exclude every assignment of their
+// variables with one parity. The clause with the variables of the set N negated excludes the assignment that sets
+// exactly N true, so the sign patterns of a complete set are all those with an even, or all with an odd, number of
+// negations. The clauses stay, so the rows are only needed by `eliminate_xors`.
+vector<xor_constraint> solver::detect_xors() {
+    vector<xor_constraint> found;
+    map<vector<uint>, uint64_t> patterns; // the sign patterns seen, by the sorted variables
+    vector<int> lits;
+    vector<uint> key;
+    for (auto r : db[TIER_CORE]) {
+        auto c = deref(r);
+        if ((c->flags & (CLAUSE_LEARNT | CLAUSE_DELETED)) != 0 || c->num_lit < 3 || c->num_lit > XOR_DETECT_MAX_SIZE)
+            continue;
+        lits.assign(c->lits, c->lits + c->num_lit);
+        sort(lits.begin(), lits.end(), [](int a, int b) { return abs(a) < abs(b); });
+        key.clear();
+        uint pattern = 0;
+        for (uint i = 0; i < lits.size(); ++i) {
+            key.push_back(abs(lits[i]));
+            pattern |= (lits[i] < 0) << i;
+        }
+        patterns[key] |= 1ull << pattern;
+    }
+    for (auto & [vars, seen] : patterns) {
+        uint k = vars.size();
+        for (uint parity : { 0, 1 }) {
+            bool complete = true;
+            for (uint pattern = 0; pattern < 1u << k && complete; ++pattern)
+                complete = __builtin_parity(pattern) != parity || (seen >> pattern & 1) != 0;
+            if (! complete)
+                continue;
+            found.push_back({ parity == 0, 0, vars }); // the excluded parity is `parity`
+            STAT(++stats.xors);
+        }
+    }
+    return found;
+}
+
+void solver::watch_xor(uint index) {
+    auto & x = xors[index];
+    xor_watch[x.vars[0]].push_back(index);
+    xor_watch[x.vars[1]].push_back(index);
+}
+
+// Take the variables assigned at level 0 out of a row, and assign or equate what is left if it has one or two
+// variables. False if it has none left and cannot hold.
+bool solver::simplify_xor(xor_constraint & x) {
+    uint size = 0;
+    for (uint v : x.vars) {
+        if (defined(v))
+            x.rhs ^= phase(v);
+        else
+            x.vars[size++] = v;
+    }
+    x.vars.resize(size);
+    if (size == 0)
+        return ! x.rhs;
+    int a = x.vars[0];
+    if (size == 1) {
+        push(x.rhs ? a : -a, NO_CLAUSE, 0);
+        STAT(++stats.xor_units);
+    } else if (size == 2) { // a = b, or a = -b
+        int b = x.rhs ? -(int) x.vars[1] : x.vars[1];
+        add_binary(a, -b);
+        add_binary(-a, b);
+        STAT(++stats.xor_units);
+    }
+    return true;
+}
+
+// Gauss-Jordan elimination, at level 0, of the rows together with `implied`, rows the clauses already imply, over a
+// matrix of packed bits. Rows are combined a 64-bit word at a time, and only from the pivot column on, as the pivot
+// row is zero before it. What the search gets from it are the units and equivalences of the reduced system, and its
+// inconsistency. The reduced rows themselves are not watched: they tend to be much longer than the original ones, and
+// so propagate later and give longer reasons. Returns false if the system has no solution.
+bool solver::eliminate_xors(const vector<xor_constraint> & implied) {
+    TIME_PHASE(PHASE_GAUSS);
+    backjump(0);
+    if (find_conflict())
+        return ok = false;
+    STAT(++stats.eliminations);
+    for (auto & x : xor_pending)
+        xors.push_back(move(x));
+    xor_pending.clear();
+    for (auto & wlist : xor_watch)
+        wlist.clear();
+
+    vector<const xor_constraint *> rows;
+    for (auto & x : xors)
+        rows.push_back(&x);
+    for (auto & x : implied)
+        rows.push_back(&x);
+    vector<uint> column(N + 1, ~0u), column_var;
+    for (auto x : rows) {
+        for (uint v : x->vars) {
+            if (! defined(v) && column[v] == ~0u) {
+                column[v] = column_var.size();
+                column_var.push_back(v);
+            }
+        }
+    }
+    uint num_col = column_var.size(), num_row = rows.size(), words = num_col / 64 + 1;
+    if ((uint64_t) num_row * words <= GAUSS_MAX_WORDS) {
+        vector<uint64_t> bits(num_row * words);
+        vector<char> rhs(num_row);
+        for (uint i = 0; i < num_row; ++i) {
+            rhs[i] = rows[i]->rhs;
+            for (uint v : rows[i]->vars) {
+                if (defined(v))
+                    rhs[i] ^= phase(v);
+                else
+                    bits[i * words + column[v] / 64] ^= 1ull << column[v] % 64;
+            }
+        }
+        uint rank = 0;
+        for (uint col = 0; col < num_col && rank < num_row; ++col) {
+            uint w = col / 64;
+            uint64_t mask = 1ull << col % 64;
+            uint pivot = rank;
+            while (pivot < num_row && (bits[pivot * words + w] & mask) == 0)
+                ++pivot;
+            if (pivot == num_row)
+                continue;
+            if (pivot != rank) {
+                swap_ranges(&bits[pivot * words], &bits[pivot * words] + words, &bits[rank * words]);
+                swap(rhs[pivot], rhs[rank]);
+            }
+            const uint64_t * p = &bits[rank * words];
+            for (uint i = 0; i < num_row; ++i) {
+                uint64_t * q = &bits[i * words];
+                if (i == rank || (q[w] & mask) == 0)
+                    continue;
+                for (uint k = w; k < words; ++k)
+                    q[k] ^= p[k];
+                rhs[i] ^= rhs[rank];
+            }
+            ++rank;
+        }
+        for (uint i = rank; i < num_row; ++i) { // all zero
+            if (rhs[i])
+                return ok = false;
+        }
+        xor_constraint x;
+        for (uint i = 0; i < rank; ++i) {
+            x.rhs = rhs[i];
+            x.vars.clear();
+            for (uint k = 0; k < words && x.vars.size() <= 2; ++k) {
+                for (uint64_t word = bits[i * words + k]; word != 0; word &= word - 1)
+                    x.vars.push_back(column_var[k * 64 + __builtin_ctzll(word)]);
+            }
+            if (x.vars.size() <= 2 && ! simplify_xor(x)) // the pivots differ, so no unit is assigned twice
+                return ok = false;
+        }
+    }
+
+    uint size = 0;
+    for (uint i = 0; i < xors.size(); ++i) {
+        if (! simplify_xor(xors[i]))
+            return ok = false;
+        if (xors[i].vars.size() > 2) {
+            if (i != size)
+                xors[size] = move(xors[i]);
+            watch_xor(size++);
+        }
+    }
+    xors.resize(size);
+    if (find_conflict())
+        return ok = false;
+    return true;
+}
+
+// Visit the rows watched by var, which has just been assigned. Returns the row that is violated, if any, with its
+// clause in `constraint_conflict`.
+optional<reason_ref> solver::propagate_xors(uint var) {
+    auto & wlist = xor_watch[var];
+    uint i = 0, j = 0;
+    while (i < wlist.size()) {
+        uint index = wlist[i++];
+        auto & x = xors[index];
+        if (x.vars[0] == var)
+            swap(x.vars[0], x.vars[1]);
+        uint num_var = x.vars.size(), k = 2;
+        while (k < num_var && defined(x.vars[k]))
+            ++k;
+        if (k < num_var) { // watched from there instead
+            swap(x.vars[1], x.vars[k]);
+            xor_watch[x.vars[1]].push_back(index);
+            continue;
+        }
+        wlist[j++] = index;
+        bool sum = x.rhs;
+        uint lv = 0;
+        for (k = 1; k < num_var; ++k) {
+            sum ^= phase(x.vars[k]);
+            lv = max(lv, vars[x.vars[k]].level);
+        }
+        uint v = x.vars[0];
+        if (! defined(v)) {
+            x.implied = v;
+            push(sum ? v : -(int) v, XOR_REASON | index, lv);
+            continue;
+        }
+        if (phase(v) == sum)
+            continue;
+        while (i < wlist.size())
+            wlist[j++] = wlist[i++];
+        wlist.resize(j);
+        constraint_conflict.clear();
+        for (uint v : x.vars)
+            constraint_conflict.push_back(phase(v) ? -(int) v : v);
+        return XOR_REASON | index;
+    }
+    wlist.resize(j);
+    return nullopt;
+}